@@ -0,0 +1,153 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Compares scan_actions_xml() with a pugixml DOM walk on actions.xml files
+// and checks that both find the same file names.
+
+#include <shimejifinder/actions_scanner.hpp>
+#include <shimejifinder/utils.hpp>
+#include <pugixml.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+
+static std::atomic<size_t> allocations { 0 };
+
+void *operator new(size_t size) {
+    ++allocations;
+    void *ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept {
+    (void)size;
+    free(ptr);
+}
+
+// implementation used before scan_actions_xml()
+static std::set<std::string> pugixml_paths(std::string const& actions_xml) {
+    pugi::xml_document doc;
+    doc.load_string(actions_xml.c_str(), pugi::parse_default);
+    auto mascot = doc.child("Mascot");
+    if (mascot == nullptr)
+        mascot = doc.child("マスコット");
+    if (mascot == nullptr) {
+        return {};
+    }
+    std::set<std::string> paths;
+    std::vector<pugi::xml_node> search_next = { mascot };
+    while (!search_next.empty()) {
+        size_t size = search_next.size();
+        for (size_t i=0; i<size; ++i) {
+            pugi::xml_node node = search_next[i];
+            auto name = node.name();
+            if (name != NULL && (strcmp(name, "Pose") == 0 ||
+                strcmp(name, "ポーズ") == 0))
+            {
+                static const std::vector<std::string> attr_names =
+                    { "画像", "Image", "ImageRight", "Sound" };
+                for (auto &attr_name : attr_names) {
+                    auto attr = node.attribute(attr_name);
+                    if (!attr.empty()) {
+                        paths.insert(shimejifinder::to_lower(attr.as_string()));
+                    }
+                }
+            }
+            else {
+                for (auto child : node.children()) {
+                    if (child.type() == pugi::xml_node_type::node_element) {
+                        search_next.push_back(child);
+                    }
+                }
+            }
+        }
+        search_next.erase(search_next.begin(),
+            search_next.begin() + size);
+    }
+    return paths;
+}
+
+static std::set<std::string> scanner_paths(std::string const& actions_xml) {
+    std::set<std::string> paths;
+    shimejifinder::scan_actions_xml(actions_xml, paths);
+    return paths;
+}
+
+static double measure(std::string const& xml, size_t iterations,
+    std::set<std::string> (*fn)(std::string const&), size_t &allocs,
+    std::set<std::string> &paths)
+{
+    size_t before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i=0; i<iterations; ++i) {
+        paths = fn(xml);
+    }
+    auto end = std::chrono::steady_clock::now();
+    allocs = (allocations - before) / iterations;
+    return std::chrono::duration<double, std::milli>(end - start).count() /
+        iterations;
+}
+
+int main(int argc, char **argv) {
+    if (argc <= 2) {
+        std::cerr << "usage: shimejifinder-bench-actions <iterations> "
+            "<actions.xml> [actions.xml...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t iterations = std::strtoul(argv[1], nullptr, 10);
+    int ret = EXIT_SUCCESS;
+
+    std::cout << "file\tbytes\tpaths\tpugixml_ms\tpugixml_allocs\t"
+        "scanner_ms\tscanner_allocs" << std::endl;
+    for (int i=2; i<argc; ++i) {
+        std::ifstream in { argv[i], std::ios::binary };
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string xml = ss.str();
+
+        std::set<std::string> expected, actual;
+        size_t pugixml_allocs, scanner_allocs;
+        double pugixml_ms = measure(xml, iterations, pugixml_paths,
+            pugixml_allocs, expected);
+        double scanner_ms = measure(xml, iterations, scanner_paths,
+            scanner_allocs, actual);
+        std::cout << std::filesystem::path(argv[i]).filename().string() <<
+            "\t" << xml.size() << "\t" << actual.size() << "\t" <<
+            pugixml_ms << "\t" << pugixml_allocs << "\t" << scanner_ms <<
+            "\t" << scanner_allocs << std::endl;
+        if (expected != actual) {
+            std::cerr << argv[i] << ": results differ" << std::endl;
+            ret = EXIT_FAILURE;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,84 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Measures how analyze_batch() scales with the number of worker threads.
+// Every archive given on the command line is queued `copies` times, then
+// the batch is run with 1, 2, 4, ... threads up to the hardware thread
+// count.
+
+#include <shimejifinder/analyze.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "C.UTF-8"); // this is required for 7z
+    if (argc <= 2) {
+        std::cerr << "usage: shimejifinder-bench-batch <copies> "
+            "<archive> [archive...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t copies = std::strtoul(argv[1], nullptr, 10);
+    auto output_root = std::filesystem::temp_directory_path() /
+        "shimejifinder-bench-batch";
+
+    std::vector<shimejifinder::batch_job> jobs;
+    for (size_t i=0; i<copies; ++i) {
+        for (int j=2; j<argc; ++j) {
+            shimejifinder::batch_job job;
+            job.filename = argv[j];
+            job.output = output_root / std::to_string(jobs.size());
+            jobs.push_back(job);
+        }
+    }
+
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    double baseline = 0;
+    std::cout << "threads\tseconds\tarchives/s\tspeedup\tfailures" << std::endl;
+    for (size_t threads = 1; ; threads *= 2) {
+        if (threads > max_threads) {
+            threads = max_threads;
+        }
+        std::filesystem::remove_all(output_root);
+        auto start = std::chrono::steady_clock::now();
+        auto results = shimejifinder::analyze_batch(jobs, threads);
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        size_t failures = 0;
+        for (auto &result : results) {
+            if (!result.error.empty()) {
+                ++failures;
+            }
+        }
+        if (threads == 1) {
+            baseline = seconds;
+        }
+        std::cout << threads << "\t" << seconds << "\t" <<
+            (jobs.size() / seconds) << "\t" << (baseline / seconds) <<
+            "\t" << failures << std::endl;
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    std::filesystem::remove_all(output_root);
+}
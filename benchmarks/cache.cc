@@ -0,0 +1,68 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Measures analyze() latency with the analysis cache disabled, on a cache
+// miss and on a cache hit.
+
+#include <shimejifinder/analyze.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+static double measure(std::string const& path,
+    shimejifinder::analyze_config const& config, size_t &found)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto ar = shimejifinder::analyze(path, config);
+    auto end = std::chrono::steady_clock::now();
+    found = ar->shimejis().size();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "C.UTF-8"); // this is required for 7z
+    if (argc <= 2) {
+        std::cerr << "usage: shimejifinder-bench-cache <iterations> "
+            "<archive> [archive...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t iterations = std::strtoul(argv[1], nullptr, 10);
+    auto cache_dir = std::filesystem::temp_directory_path() /
+        "shimejifinder-bench-cache";
+
+    std::cout << "archive\tshimeji\tuncached_ms\tmiss_ms\thit_ms" << std::endl;
+    for (int i=2; i<argc; ++i) {
+        std::string path = argv[i];
+        double uncached = 0, miss = 0, hit = 0;
+        size_t found = 0;
+        for (size_t j=0; j<iterations; ++j) {
+            shimejifinder::analyze_config config;
+            uncached += measure(path, config, found);
+
+            std::filesystem::remove_all(cache_dir);
+            config.cache_dir = cache_dir.string();
+            miss += measure(path, config, found);
+            hit += measure(path, config, found);
+        }
+        std::cout << std::filesystem::path(path).filename().string() <<
+            "\t" << found << "\t" << (uncached / iterations) << "\t" <<
+            (miss / iterations) << "\t" << (hit / iterations) << std::endl;
+    }
+    std::filesystem::remove_all(cache_dir);
+}
@@ -0,0 +1,152 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Measures the entry table without reading an archive. A synthetic backend
+// lists shimeji-ee style paths, then the time and heap allocations of
+// listing, archive_folder construction and walking the entries the way
+// backends do during extraction are reported.
+
+#include <shimejifinder/archive.hpp>
+#include <shimejifinder/archive_folder.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+static std::atomic<size_t> allocations { 0 };
+static std::atomic<size_t> allocated_bytes { 0 };
+
+void *operator new(size_t size) {
+    ++allocations;
+    allocated_bytes += size;
+    void *ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t size) noexcept {
+    (void)size;
+    free(ptr);
+}
+
+class synthetic_archive : public shimejifinder::archive {
+private:
+    size_t m_count;
+    size_t m_walked;
+protected:
+    void fill_entries() override {
+        std::string path;
+        for (size_t i=0; i<m_count; ++i) {
+            if (i % 10 == 9) {
+                // not kept
+                path = "Shimeji-ee/docs/readme" + std::to_string(i) + ".txt";
+            }
+            else {
+                path = "Shimeji-ee/img/Character" + std::to_string(i / 46) +
+                    "/shime" + std::to_string(i % 46 + 1) + ".png";
+            }
+            add_entry((int)i, path);
+        }
+    }
+    void extract() override {
+        // same walk as the backends, without reading data
+        for (size_t i=0; i<m_count && !plan().done(); ++i) {
+            if (plan().take((int)i) != nullptr) {
+                ++m_walked;
+            }
+        }
+    }
+public:
+    using shimejifinder::archive::extract;
+    synthetic_archive(size_t count): m_count(count), m_walked(0) {}
+    size_t walked() const { return m_walked; }
+};
+
+class null_extractor : public shimejifinder::extractor {
+public:
+    void begin_write(shimejifinder::extract_target const& target) override {
+        (void)target;
+    }
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        (void)offset;
+        (void)buf;
+        (void)size;
+    }
+    void end_write() override {}
+};
+
+template<typename F>
+static void measure(std::string const& stage, size_t iterations, F func) {
+    double ms = 0;
+    size_t count = 0, bytes = 0;
+    for (size_t i=0; i<iterations; ++i) {
+        size_t start_count = allocations, start_bytes = allocated_bytes;
+        auto start = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        ms += std::chrono::duration<double, std::milli>(end - start).count();
+        count += allocations - start_count;
+        bytes += allocated_bytes - start_bytes;
+    }
+    std::cout << stage << "\t" << (ms / iterations) << "\t" <<
+        (count / iterations) << "\t" <<
+        (bytes / iterations / 1048576.0) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "usage: shimejifinder-bench-entries <entries> "
+            "<iterations>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t count = std::strtoul(argv[1], nullptr, 10);
+    size_t iterations = std::strtoul(argv[2], nullptr, 10);
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    std::cout << "stage\tms\tallocations\tallocated_MB" << std::endl;
+    measure("listing", iterations, [&]{
+        synthetic_archive ar { count };
+        ar.open("synthetic");
+    });
+
+    synthetic_archive ar { count };
+    ar.open("synthetic");
+    measure("archive_folder", iterations, [&]{
+        shimejifinder::archive_folder root { ar };
+    });
+
+    // every 46th entry has a target, like one pose per shimeji
+    for (size_t i=0; i<ar.size(); i += 46) {
+        ar[i]->add_target({ ar.names(), "shimeji", "shime1.png",
+            shimejifinder::extract_target::extract_type::IMAGE });
+    }
+    measure("extract_walk", iterations, [&]{
+        null_extractor extractor;
+        ar.extract(&extractor);
+    });
+}
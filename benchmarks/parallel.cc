@@ -0,0 +1,92 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+// Measures how extract() scales with the number of extract threads. The
+// extracted data is discarded, so the numbers only cover reading and
+// decompressing the archive. Thread counts double from 1 up to the given
+// maximum. The archive should be a zip file, other archives are always
+// extracted on one thread.
+
+#include <shimejifinder/analyze.hpp>
+#include <shimejifinder/extractor.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+class null_extractor : public shimejifinder::extractor {
+public:
+    void begin_write(shimejifinder::extract_target const& entry) override {
+        (void)entry;
+    }
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        (void)offset;
+        (void)buf;
+        (void)size;
+    }
+    void end_write() override {}
+};
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::cerr << "usage: shimejifinder-bench-parallel <zip> "
+            "<max threads> <iterations>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string path = argv[1];
+    size_t max_threads = std::strtoul(argv[2], nullptr, 10);
+    size_t iterations = std::strtoul(argv[3], nullptr, 10);
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    auto ar = shimejifinder::analyze(path);
+    if (ar == nullptr) {
+        std::cerr << "cannot open " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "threads\tms\tMB/s\tspeedup" << std::endl;
+    double base_ms = 0;
+    for (size_t threads=1; threads<=max_threads; threads*=2) {
+        auto config = ar->config();
+        config.extract_threads = threads;
+        ar->set_config(config);
+        double ms = 0;
+        uint64_t bytes = 0;
+        for (size_t i=0; i<iterations; ++i) {
+            null_extractor extractor;
+            uint64_t written = ar->stats().bytes_written;
+            auto start = std::chrono::steady_clock::now();
+            ar->extract(&extractor);
+            auto end = std::chrono::steady_clock::now();
+            ms += std::chrono::duration<double, std::milli>(end - start).count();
+            bytes += ar->stats().bytes_written - written;
+        }
+        ms /= iterations;
+        if (threads == 1) {
+            base_ms = ms;
+        }
+        std::cout << threads << "\t" << ms << "\t" <<
+            (bytes / 1048576.0 / iterations) / (ms / 1000) << "\t" <<
+            (base_ms / ms) << std::endl;
+    }
+}
@@ -0,0 +1,94 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Measures extract() with and without the write queue while the
+// extractor writes to a slow disk. The disk is simulated by an
+// fs_extractor that sleeps after every write for as long as the given
+// throughput would take, so the numbers do not depend on the machine's
+// storage. Extracted files are written to a temporary directory.
+
+#include <shimejifinder/analyze.hpp>
+#include <shimejifinder/fs_extractor.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+class slow_extractor : public shimejifinder::fs_extractor {
+private:
+    double m_bytes_per_ns;
+public:
+    slow_extractor(std::filesystem::path output, double megabytes_per_second):
+        fs_extractor(output),
+        m_bytes_per_ns(megabytes_per_second * 1048576.0 / 1e9) {}
+
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        fs_extractor::write_next(offset, buf, size);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(
+            (int64_t)(size / m_bytes_per_ns)));
+    }
+};
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::cerr << "usage: shimejifinder-bench-pipeline <archive> "
+            "<disk MB/s> <iterations>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::string path = argv[1];
+    double speed = std::strtod(argv[2], nullptr);
+    size_t iterations = std::strtoul(argv[3], nullptr, 10);
+    if (speed <= 0) {
+        speed = 1;
+    }
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    auto ar = shimejifinder::analyze(path);
+    if (ar == nullptr) {
+        std::cerr << "cannot open " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto output = std::filesystem::temp_directory_path() /
+        ("shimejifinder-bench-pipeline-" + std::to_string(getpid()));
+
+    std::cout << "queue_blocks\tms\tMB/s" << std::endl;
+    for (size_t blocks : { 0, 4, 16, 64, 256 }) {
+        auto config = ar->config();
+        config.write_queue_blocks = blocks;
+        ar->set_config(config);
+        double ms = 0;
+        uint64_t bytes = 0;
+        for (size_t i=0; i<iterations; ++i) {
+            std::filesystem::remove_all(output);
+            slow_extractor extractor { output, speed };
+            uint64_t written = ar->stats().bytes_written;
+            auto start = std::chrono::steady_clock::now();
+            ar->extract(&extractor);
+            auto end = std::chrono::steady_clock::now();
+            ms += std::chrono::duration<double, std::milli>(end - start).count();
+            bytes += ar->stats().bytes_written - written;
+        }
+        std::cout << blocks << "\t" << (ms / iterations) << "\t" <<
+            (bytes / 1048576.0) / (ms / 1000) << std::endl;
+    }
+    std::filesystem::remove_all(output);
+}
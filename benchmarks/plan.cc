@@ -0,0 +1,66 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Compares the time needed to analyze an archive with the time needed
+// to load a saved extraction plan for it. Loading a plan lists the
+// archive to check that the plan was made for it.
+
+#include <shimejifinder/analyze.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "C.UTF-8"); // this is required for 7z
+    if (argc <= 2) {
+        std::cerr << "usage: shimejifinder-bench-plan <iterations> "
+            "<archive> [archive...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t iterations = std::strtoul(argv[1], nullptr, 10);
+
+    std::cout << "archive\tplan_bytes\tanalyze_ms\tload_ms" << std::endl;
+    for (int i=2; i<argc; ++i) {
+        std::string path = argv[i];
+        double analyze_ms = 0, load_ms = 0;
+        std::string plan;
+        for (size_t j=0; j<iterations; ++j) {
+            auto start = std::chrono::steady_clock::now();
+            auto ar = shimejifinder::analyze(path);
+            auto end = std::chrono::steady_clock::now();
+            analyze_ms += std::chrono::duration<double, std::milli>(
+                end - start).count();
+
+            std::ostringstream out;
+            ar->save_plan(out);
+            plan = out.str();
+
+            start = std::chrono::steady_clock::now();
+            std::istringstream in { plan };
+            auto loaded = shimejifinder::load_plan(in, path);
+            end = std::chrono::steady_clock::now();
+            load_ms += std::chrono::duration<double, std::milli>(
+                end - start).count();
+        }
+        std::cout << std::filesystem::path(path).filename().string() <<
+            "\t" << plan.size() << "\t" << (analyze_ms / iterations) <<
+            "\t" << (load_ms / iterations) << std::endl;
+    }
+}
@@ -0,0 +1,201 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Replays analyze() and extract() over every archive in a directory, the
+// way a service would process uploads, and reports throughput, per-archive
+// latency, peak memory and failures. With "compare", the corpus is also
+// replayed with each backend on its own so that a library upgrade can be
+// checked against real archives before it is rolled out.
+
+#include <shimejifinder/analyze.hpp>
+#include <shimejifinder/utils.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+struct replay_result {
+    double seconds = 0;
+    bool failed = false;
+    bool fell_back = false;
+    std::string backend;
+    std::string error;
+};
+
+struct replay_summary {
+    std::string name;
+    size_t failures = 0;
+    size_t fallbacks = 0;
+    double seconds = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    uint64_t peak_rss_kb = 0;
+};
+
+// peak resident set size of the process in KiB. On Linux the peak can be
+// reset, so every replay reports its own peak.
+static void reset_peak_rss() {
+    std::ofstream clear_refs { "/proc/self/clear_refs" };
+    if (clear_refs) {
+        clear_refs << "5" << std::endl;
+    }
+}
+
+static uint64_t peak_rss_kb() {
+    std::ifstream status { "/proc/self/status" };
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    #if __APPLE__
+        return usage.ru_maxrss / 1024;
+    #else
+        return usage.ru_maxrss;
+    #endif
+}
+
+static double percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+static replay_summary replay(std::string const& name,
+    std::vector<std::filesystem::path> const& archives, size_t threads,
+    shimejifinder::analyze_config const& config)
+{
+    auto output_root = std::filesystem::temp_directory_path() /
+        "shimejifinder-bench-replay";
+    std::vector<replay_result> results(archives.size());
+    std::atomic<size_t> next { 0 };
+
+    reset_peak_rss();
+    auto start = std::chrono::steady_clock::now();
+    shimejifinder::parallel_for(archives.size(), threads, [&](size_t){
+        // archives are taken in order, not by the index of this call, so
+        // that every thread starts on the next archive of the corpus
+        size_t idx = next++;
+        auto &result = results[idx];
+        auto output = output_root / std::to_string(idx);
+        auto archive_start = std::chrono::steady_clock::now();
+        try {
+            auto ar = shimejifinder::analyze(archives[idx].string(), config);
+            ar->extract(output);
+            result.backend = ar->backend_name();
+            result.fell_back = ar->stats().backend_fallbacks > 0;
+        }
+        catch (std::exception &ex) {
+            result.failed = true;
+            result.error = ex.what();
+        }
+        result.seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - archive_start).count();
+        std::error_code err;
+        std::filesystem::remove_all(output, err);
+    });
+    replay_summary summary;
+    summary.name = name;
+    summary.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    summary.peak_rss_kb = peak_rss_kb();
+
+    std::vector<double> latencies;
+    for (size_t i=0; i<results.size(); ++i) {
+        auto &result = results[i];
+        latencies.push_back(result.seconds * 1000);
+        if (result.failed) {
+            ++summary.failures;
+            std::cerr << name << ": " << archives[i].string() << ": " <<
+                result.error << std::endl;
+        }
+        if (result.fell_back) {
+            ++summary.fallbacks;
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    summary.p50_ms = percentile(latencies, 0.5);
+    summary.p99_ms = percentile(latencies, 0.99);
+    std::filesystem::remove_all(output_root);
+    return summary;
+}
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "C.UTF-8"); // this is required for 7z
+    if (argc != 3 && !(argc == 4 && std::string(argv[3]) == "compare")) {
+        std::cerr << "usage: shimejifinder-bench-replay <threads> "
+            "<directory> [compare]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t threads = std::strtoul(argv[1], nullptr, 10);
+    if (threads == 0) {
+        threads = shimejifinder::default_thread_count();
+    }
+    bool compare = argc == 4;
+
+    std::vector<std::filesystem::path> archives;
+    uintmax_t total_bytes = 0;
+    for (auto &file : std::filesystem::recursive_directory_iterator(
+        argv[2]))
+    {
+        if (file.is_regular_file()) {
+            archives.push_back(file.path());
+            total_bytes += file.file_size();
+        }
+    }
+    std::sort(archives.begin(), archives.end());
+    if (archives.empty()) {
+        std::cerr << "no archives in " << argv[2] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    using backend_type = shimejifinder::analyze_config::backend_type;
+    std::vector<std::pair<std::string, backend_type>> runs {
+        { "auto", backend_type::AUTO } };
+    if (compare) {
+        runs.push_back({ "libarchive", backend_type::LIBARCHIVE });
+        runs.push_back({ "libunarr", backend_type::LIBUNARR });
+    }
+
+    std::cout << "backend\tarchives\tfailures\tfallbacks\tseconds\t"
+        "archives/s\tMB/s\tp50_ms\tp99_ms\tpeak_rss_MB" << std::endl;
+    for (auto &run : runs) {
+        shimejifinder::analyze_config config;
+        config.backend = run.second;
+        auto summary = replay(run.first, archives, threads, config);
+        std::cout << summary.name << "\t" << archives.size() << "\t" <<
+            summary.failures << "\t" << summary.fallbacks << "\t" <<
+            summary.seconds << "\t" <<
+            (archives.size() / summary.seconds) << "\t" <<
+            (total_bytes / 1048576.0 / summary.seconds) << "\t" <<
+            summary.p50_ms << "\t" << summary.p99_ms << "\t" <<
+            (summary.peak_rss_kb / 1024.0) << std::endl;
+    }
+}
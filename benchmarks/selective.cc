@@ -0,0 +1,158 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Measures extraction of a few entries from a large zip file, once by
+// going through the whole file and once by reading the needed entries
+// directly from the offsets in the central directory. The page cache of
+// the archive is dropped before every iteration so that both read from
+// disk.
+//
+// `generate` writes a zip file of the given size made of 256 KiB stored
+// entries, which is the worst case for going through the whole file.
+
+#include <shimejifinder/libarchive/archive.hpp>
+#include <archive.h>
+#include <archive_entry.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+static const size_t entry_size = 256 * 1024;
+
+static int generate(const char *path, size_t megabytes) {
+    auto ar = archive_write_new();
+    if (archive_write_set_format_zip(ar) != ARCHIVE_OK ||
+        archive_write_set_options(ar, "compression=store") != ARCHIVE_OK ||
+        archive_write_open_filename(ar, path) != ARCHIVE_OK)
+    {
+        std::cerr << "cannot create " << path << ": " <<
+            archive_error_string(ar) << std::endl;
+        archive_write_free(ar);
+        return EXIT_FAILURE;
+    }
+    std::string data(entry_size, '\0');
+    uint64_t state = 1;
+    size_t count = megabytes * 1024 * 1024 / entry_size;
+    for (size_t i=0; i<count; ++i) {
+        // xorshift, the data only has to be incompressible
+        for (size_t j=0; j<data.size(); j += 8) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            memcpy(&data[j], &state, 8);
+        }
+        auto entry = archive_entry_new();
+        auto name = "Pack/data/blob" + std::to_string(i) + ".png";
+        archive_entry_copy_pathname(entry, name.c_str());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, (la_int64_t)data.size());
+        archive_entry_set_mtime(entry, 1735689600, 0);
+        archive_write_header(ar, entry);
+        archive_entry_free(entry);
+        archive_write_data(ar, data.data(), data.size());
+    }
+    archive_write_close(ar);
+    archive_write_free(ar);
+    return EXIT_SUCCESS;
+}
+
+class null_extractor : public shimejifinder::extractor {
+public:
+    size_t files = 0;
+    void begin_write(shimejifinder::extract_target const& target) override {
+        (void)target;
+        ++files;
+    }
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        (void)offset;
+        (void)buf;
+        (void)size;
+    }
+    void end_write() override {}
+};
+
+static void drop_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd != -1) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static double measure(const char *path, size_t files, bool random_access,
+    size_t iterations)
+{
+    shimejifinder::analyze_config config;
+    config.random_access = random_access;
+    config.max_total_bytes = 0;
+    config.max_entries = 0;
+    double ms = 0;
+    for (size_t i=0; i<iterations; ++i) {
+        shimejifinder::libarchive::archive backend;
+        shimejifinder::archive &ar = backend;
+        ar.set_config(config);
+        ar.open(path);
+
+        // spread the targets over the whole file
+        size_t step = ar.size() / files;
+        for (size_t j=0; j<files && j * step < ar.size(); ++j) {
+            ar[j * step + step / 2]->add_target({ ar.names(), "bench",
+                std::to_string(j) + ".png",
+                shimejifinder::extract_target::extract_type::IMAGE });
+        }
+        drop_cache(path);
+        null_extractor extractor;
+        auto start = std::chrono::steady_clock::now();
+        ar.extract(&extractor);
+        auto end = std::chrono::steady_clock::now();
+        ms += std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    return ms / iterations;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 4 && std::string(argv[1]) == "generate") {
+        return generate(argv[2], std::strtoul(argv[3], nullptr, 10));
+    }
+    if (argc != 4) {
+        std::cerr << "usage: shimejifinder-bench-selective <archive.zip> "
+            "<files> <iterations>" << std::endl;
+        std::cerr << "       shimejifinder-bench-selective generate "
+            "<archive.zip> <megabytes>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t files = std::strtoul(argv[2], nullptr, 10);
+    size_t iterations = std::strtoul(argv[3], nullptr, 10);
+    if (files == 0) {
+        files = 1;
+    }
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    std::cout << "mode\tms" << std::endl;
+    std::cout << "streaming\t" << measure(argv[1], files, false,
+        iterations) << std::endl;
+    std::cout << "direct\t" << measure(argv[1], files, true,
+        iterations) << std::endl;
+}
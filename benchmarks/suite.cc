@@ -0,0 +1,521 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+// Generates a synthetic corpus of shimeji archives and measures each stage
+// of the library on it separately: analyze(), archive_folder construction,
+// find_paths and register_shimeji (taken from archive::stats()), listing
+// and extraction by each backend, and both extractors. Results are written
+// to stdout as JSON.
+//
+// The corpus is generated from a fixed seed with fixed timestamps, so the
+// same archives are measured by every run and build. libarchive cannot
+// write RAR archives; RAR files and any other archives given on the
+// command line are measured after the generated corpus.
+
+#include <shimejifinder/analyze.hpp>
+#include <shimejifinder/archive_folder.hpp>
+#include <shimejifinder/fs_extractor.hpp>
+#include <shimejifinder/memory_extractor.hpp>
+#include <shimejifinder/libarchive/archive.hpp>
+#include <shimejifinder/libunarr/archive.hpp>
+#include <archive.h>
+#include <archive_entry.h>
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// splitmix64, the corpus must not depend on the standard library's
+// random number engines
+class generator {
+private:
+    uint64_t m_state;
+public:
+    explicit generator(uint64_t seed): m_state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // png signature followed by data that compresses about as well as
+    // real sprites
+    std::string image(size_t size) {
+        std::string data = "\x89PNG\r\n\x1a\n";
+        while (data.size() < size) {
+            uint64_t value = next();
+            size_t run = 1 + (value & 15);
+            data.append(std::min(run, size - data.size()),
+                (char)(value >> 8));
+        }
+        return data;
+    }
+};
+
+class archive_writer {
+private:
+    ::archive *m_ar;
+    void check(int ret, const char *what) {
+        if (ret != ARCHIVE_OK) {
+            const char *err = archive_error_string(m_ar);
+            throw std::runtime_error(std::string(what) + ": " +
+                (err != nullptr ? err : "unknown error"));
+        }
+    }
+public:
+    archive_writer(std::filesystem::path const& path, bool seven_zip) {
+        m_ar = archive_write_new();
+        if (seven_zip) {
+            check(archive_write_set_format_7zip(m_ar), "7zip");
+            check(archive_write_set_options(m_ar, "compression=deflate"),
+                "7zip options");
+        }
+        else {
+            check(archive_write_set_format_zip(m_ar), "zip");
+        }
+        check(archive_write_open_filename(m_ar, path.c_str()), "open");
+    }
+
+    void add(std::string const& name, std::string const& data) {
+        auto entry = archive_entry_new();
+        archive_entry_copy_pathname(entry, name.c_str());
+        archive_entry_set_filetype(entry, AE_IFREG);
+        archive_entry_set_perm(entry, 0644);
+        archive_entry_set_size(entry, (la_int64_t)data.size());
+        archive_entry_set_mtime(entry, 1735689600, 0);
+        int ret = archive_write_header(m_ar, entry);
+        archive_entry_free(entry);
+        check(ret, "write header");
+        if (archive_write_data(m_ar, data.data(), data.size()) !=
+            (la_ssize_t)data.size())
+        {
+            check(ARCHIVE_FATAL, "write data");
+        }
+    }
+
+    archive_writer(archive_writer const&) = delete;
+    archive_writer &operator=(archive_writer const&) = delete;
+
+    ~archive_writer() {
+        archive_write_close(m_ar);
+        archive_write_free(m_ar);
+    }
+};
+
+static const size_t images_per_shimeji = 46;
+
+static std::string actions_xml() {
+    std::ostringstream out;
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+        "<Mascot xmlns=\"http://www.group-finity.com/Mascot\">\n"
+        "\t<ActionList>\n";
+    for (size_t i=1; i<=images_per_shimeji; ++i) {
+        out << "\t\t<Action Name=\"Action" << i << "\" Type=\"Stay\">\n"
+            "\t\t\t<Animation>\n"
+            "\t\t\t\t<Pose Image=\"/shime" << i << ".png\" "
+            "ImageAnchor=\"64,128\" Velocity=\"0,0\" Duration=\"250\" />\n"
+            "\t\t\t</Animation>\n"
+            "\t\t</Action>\n";
+    }
+    out << "\t</ActionList>\n</Mascot>\n";
+    return out.str();
+}
+
+static std::string behaviors_xml() {
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>\n"
+        "<Mascot xmlns=\"http://www.group-finity.com/Mascot\">\n"
+        "\t<BehaviorList>\n"
+        "\t\t<Behavior Name=\"Action1\" Frequency=\"100\" />\n"
+        "\t</BehaviorList>\n</Mascot>\n";
+}
+
+// root/img/shimeN.png and root/conf/{actions,behaviors}.xml
+static void add_shimeji(archive_writer &out, generator &gen,
+    std::string const& root, size_t image_size)
+{
+    for (size_t i=1; i<=images_per_shimeji; ++i) {
+        out.add(root + "/img/shime" + std::to_string(i) + ".png",
+            gen.image(image_size));
+    }
+    out.add(root + "/conf/actions.xml", actions_xml());
+    out.add(root + "/conf/behaviors.xml", behaviors_xml());
+}
+
+// shimeji-ee layout, root/conf/ is shared by root/img/<name>/
+static size_t add_shimejiee(archive_writer &out, generator &gen,
+    std::string const& root, size_t characters, size_t image_size)
+{
+    out.add(root + "/conf/actions.xml", actions_xml());
+    out.add(root + "/conf/behaviors.xml", behaviors_xml());
+    out.add(root + "/Shimeji-ee.jar", gen.image(image_size));
+    for (size_t i=0; i<characters; ++i) {
+        auto folder = root + "/img/Character" + std::to_string(i);
+        for (size_t j=1; j<=images_per_shimeji; ++j) {
+            out.add(folder + "/shime" + std::to_string(j) + ".png",
+                gen.image(image_size));
+        }
+    }
+    return 3 + characters * images_per_shimeji;
+}
+
+static std::string read_file(std::filesystem::path const& path) {
+    std::ifstream in { path, std::ios::binary };
+    std::ostringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+static std::vector<std::filesystem::path> generate_corpus(
+    std::filesystem::path const& dir)
+{
+    std::filesystem::create_directories(dir);
+    std::vector<std::filesystem::path> corpus;
+    auto path = [&](std::string const& name) {
+        corpus.push_back(dir / name);
+        return corpus.back();
+    };
+
+    // names are written as raw bytes, Shift-JIS names must not be
+    // converted from the current locale
+    std::string locale = setlocale(LC_ALL, nullptr);
+    setlocale(LC_ALL, "C");
+    generator gen { 1 };
+    {
+        archive_writer out { path("single.zip"), false };
+        add_shimeji(out, gen, "Shimeji", 4096);
+    }
+    {
+        archive_writer out { path("single.7z"), true };
+        add_shimeji(out, gen, "Shimeji", 4096);
+    }
+    {
+        archive_writer out { path("shift_jis.zip"), false };
+        // "しめじ"
+        add_shimeji(out, gen, "\x82\xb5\x82\xdf\x82\xb6", 4096);
+    }
+    {
+        archive_writer out { path("shimejiee_50.zip"), false };
+        add_shimejiee(out, gen, "Shimeji-ee", 50, 4096);
+    }
+    {
+        archive_writer out { path("nested_zip.zip"), false };
+        out.add("packs/single.zip", read_file(dir / "single.zip"));
+        out.add("packs/shimejiee_50.zip", read_file(dir /
+            "shimejiee_50.zip"));
+    }
+    {
+        archive_writer out { path("nested_7z.zip"), false };
+        out.add("packs/single.7z", read_file(dir / "single.7z"));
+    }
+    {
+        archive_writer out { path("entries_100k.zip"), false };
+        size_t count = add_shimejiee(out, gen, "Shimeji-ee",
+            100000 / images_per_shimeji, 64);
+        for (size_t i=count; i<100000; ++i) {
+            out.add("Shimeji-ee/docs/readme" + std::to_string(i) + ".txt",
+                "readme");
+        }
+    }
+    setlocale(LC_ALL, locale.c_str());
+    return corpus;
+}
+
+struct result {
+    std::string benchmark;
+    std::string backend;
+    std::string archive;
+    std::vector<uint64_t> samples;
+    std::string error;
+};
+
+static std::string json_string(std::string const& str) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : str) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out << buf;
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+static void print_json(std::ostream &out, size_t iterations,
+    std::vector<result> &results)
+{
+    out << "{\n  \"iterations\": " << iterations << ",\n  \"results\": [";
+    for (size_t i=0; i<results.size(); ++i) {
+        auto &res = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"benchmark\": " <<
+            json_string(res.benchmark) << ", \"backend\": " <<
+            json_string(res.backend) << ", \"archive\": " <<
+            json_string(res.archive);
+        if (!res.error.empty()) {
+            out << ", \"error\": " << json_string(res.error) << "}";
+            continue;
+        }
+        auto &samples = res.samples;
+        std::sort(samples.begin(), samples.end());
+        uint64_t sum = 0;
+        for (auto sample : samples) {
+            sum += sample;
+        }
+        out << ", \"min_ns\": " << samples.front() << ", \"median_ns\": " <<
+            samples[samples.size() / 2] << ", \"mean_ns\": " <<
+            (sum / samples.size()) << ", \"max_ns\": " << samples.back() <<
+            "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// runs func once to warm up, then once per iteration. func returns the
+// time of the part it measures.
+static void measure(std::vector<result> &results, std::string const& benchmark,
+    std::string const& backend, std::string const& archive,
+    size_t iterations, std::function<uint64_t ()> func)
+{
+    result res;
+    res.benchmark = benchmark;
+    res.backend = backend;
+    res.archive = archive;
+    try {
+        func();
+        for (size_t i=0; i<iterations; ++i) {
+            res.samples.push_back(func());
+        }
+    }
+    catch (std::exception &ex) {
+        res.samples.clear();
+        res.error = ex.what();
+    }
+    results.push_back(std::move(res));
+}
+
+// discards everything, extraction is measured without extractor costs
+class null_extractor : public shimejifinder::extractor {
+public:
+    void begin_write(shimejifinder::extract_target const& target) override {
+        (void)target;
+    }
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        (void)offset;
+        (void)buf;
+        (void)size;
+    }
+    void end_write() override {}
+};
+
+// every entry kept by the backend is extracted under its index
+static void target_all(shimejifinder::archive &ar) {
+    for (size_t i=0; i<ar.size(); ++i) {
+        ar[i]->add_target({ ar.names(), "bench", std::to_string(i) + ".bin",
+            shimejifinder::extract_target::extract_type::IMAGE });
+    }
+}
+
+template<typename T>
+static void measure_backend(std::vector<result> &results, std::string const& backend,
+    std::filesystem::path const& path, size_t iterations)
+{
+    auto name = path.filename().string();
+    measure(results, "fill_entries", backend, name, iterations, [&]{
+        T ar;
+        auto start = std::chrono::steady_clock::now();
+        ar.open(path.string());
+        return elapsed_ns(start);
+    });
+    measure(results, "extract", backend, name, iterations, [&]{
+        T backend;
+        shimejifinder::archive &ar = backend;
+        ar.open(path.string());
+        target_all(ar);
+        null_extractor extractor;
+        auto start = std::chrono::steady_clock::now();
+        ar.extract(&extractor);
+        return elapsed_ns(start);
+    });
+}
+
+// data of every entry, written to each extractor without reading the
+// archive again
+struct payload {
+    shimejifinder::extract_target target;
+    std::string data;
+};
+
+static void measure_extractors(std::vector<result> &results,
+    std::filesystem::path const& path, size_t iterations)
+{
+    auto name = path.filename().string();
+    // targets outlive the archive they were read from
+    shimejifinder::name_pool names;
+    std::vector<payload> payloads;
+    {
+        auto ar = shimejifinder::analyze(path.string());
+        if (ar == nullptr) {
+            return;
+        }
+        target_all(*ar);
+        shimejifinder::memory_extractor extractor;
+        ar->extract(&extractor);
+        for (size_t i=0; i<ar->size(); ++i) {
+            auto file = std::to_string(i) + ".bin";
+            if (extractor.contains(file)) {
+                payloads.push_back({ { names, "bench", file,
+                    shimejifinder::extract_target::extract_type::IMAGE },
+                    extractor.data(file) });
+            }
+        }
+    }
+    auto write_all = [&](shimejifinder::extractor &extractor) {
+        for (auto &file : payloads) {
+            extractor.begin_write(file.target);
+            extractor.write_next(0, file.data.data(), file.data.size());
+            extractor.end_write();
+        }
+        extractor.finalize();
+    };
+    measure(results, "memory_extractor", "", name, iterations, [&]{
+        shimejifinder::memory_extractor extractor;
+        auto start = std::chrono::steady_clock::now();
+        write_all(extractor);
+        return elapsed_ns(start);
+    });
+    auto output = std::filesystem::temp_directory_path() /
+        "shimejifinder-bench-suite";
+    measure(results, "fs_extractor", "", name, iterations, [&]{
+        std::filesystem::remove_all(output);
+        shimejifinder::fs_extractor extractor { output };
+        auto start = std::chrono::steady_clock::now();
+        write_all(extractor);
+        return elapsed_ns(start);
+    });
+    std::filesystem::remove_all(output);
+}
+
+static void measure_archive(std::vector<result> &results,
+    std::filesystem::path const& path, size_t iterations)
+{
+    auto name = path.filename().string();
+    auto analyze = [&]{
+        auto ar = shimejifinder::analyze(path.string());
+        if (ar == nullptr) {
+            throw std::runtime_error("analyze() failed");
+        }
+        return ar;
+    };
+
+    // find_paths and register_shimeji only run inside analyze(), their
+    // time is taken from the stats of the same runs
+    result find_paths { "find_paths", "", name, {}, "" };
+    result register_shimeji { "register_shimeji", "", name, {}, "" };
+    measure(results, "analyze", "", name, iterations, [&]{
+        auto start = std::chrono::steady_clock::now();
+        auto ar = analyze();
+        uint64_t time = elapsed_ns(start);
+        find_paths.samples.push_back(ar->stats().find_paths.wall_ns);
+        register_shimeji.samples.push_back(
+            ar->stats().path_resolution.wall_ns);
+        return time;
+    });
+    if (results.back().error.empty()) {
+        // first sample is the warm-up run
+        find_paths.samples.erase(find_paths.samples.begin());
+        register_shimeji.samples.erase(register_shimeji.samples.begin());
+        results.push_back(std::move(find_paths));
+        results.push_back(std::move(register_shimeji));
+    }
+
+    measure(results, "archive_folder", "", name, iterations, [&]{
+        auto ar = analyze();
+        auto start = std::chrono::steady_clock::now();
+        shimejifinder::archive_folder root { *ar };
+        return elapsed_ns(start);
+    });
+
+    #if !SHIMEJIFINDER_NO_LIBARCHIVE
+    measure_backend<shimejifinder::libarchive::archive>(results,
+        "libarchive", path, iterations);
+    #endif
+    #if !SHIMEJIFINDER_NO_LIBUNARR
+    measure_backend<shimejifinder::libunarr::archive>(results,
+        "libunarr", path, iterations);
+    #endif
+
+    measure_extractors(results, path, iterations);
+}
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "C.UTF-8"); // this is required for 7z
+    if (argc == 3 && std::string(argv[1]) == "generate") {
+        for (auto &path : generate_corpus(argv[2])) {
+            std::cout << path.string() << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+    if (argc <= 1) {
+        std::cerr << "usage: shimejifinder-bench-suite <iterations> "
+            "[archive...]" << std::endl;
+        std::cerr << "       shimejifinder-bench-suite generate <dir>" <<
+            std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t iterations = std::strtoul(argv[1], nullptr, 10);
+    if (iterations == 0) {
+        iterations = 1;
+    }
+    auto corpus_dir = std::filesystem::temp_directory_path() /
+        "shimejifinder-bench-corpus";
+    std::filesystem::remove_all(corpus_dir);
+    auto corpus = generate_corpus(corpus_dir);
+    for (int i=2; i<argc; ++i) {
+        corpus.push_back(argv[i]);
+    }
+
+    // diagnostics from the library go to stderr, json to stdout
+    std::vector<result> results;
+    for (auto &path : corpus) {
+        std::cerr << "==> " << path.filename().string() << std::endl;
+        measure_archive(results, path, iterations);
+    }
+    print_json(std::cout, iterations, results);
+    std::filesystem::remove_all(corpus_dir);
+}
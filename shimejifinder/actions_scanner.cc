@@ -0,0 +1,381 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "actions_scanner.hpp"
+#include "utils.hpp"
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace shimejifinder {
+
+namespace {
+
+struct name_view {
+    const char *data;
+    size_t size;
+
+    bool operator==(const char *other) const {
+        return strlen(other) == size && memcmp(data, other, size) == 0;
+    }
+    bool operator==(name_view const& other) const {
+        return other.size == size && memcmp(data, other.data, size) == 0;
+    }
+};
+
+// attributes of a pose that reference files
+static const char *const k_pose_attributes[] =
+    { "画像", "Image", "ImageRight", "Sound" };
+
+class actions_scanner {
+private:
+    const char *m_pos;
+    const char *m_end;
+    std::vector<name_view> m_open;
+    std::set<std::string> *m_target;
+    size_t m_pose_level;
+    unsigned m_seen_attributes;
+
+    static bool is_space(char c);
+    static bool is_name_end(char c);
+    bool starts_with(const char *str) const;
+    bool skip_past(const char *str);
+    bool skip_declaration();
+    void skip_spaces();
+    name_view read_name();
+    bool read_attributes(name_view const& element, bool &self_closing);
+    void add_path(const char *begin, const char *end);
+public:
+    std::set<std::string> mascot_paths;
+    std::set<std::string> alt_mascot_paths;
+    bool found_mascot;
+    bool found_alt_mascot;
+
+    explicit actions_scanner(std::string const& xml);
+    void scan();
+};
+
+actions_scanner::actions_scanner(std::string const& xml):
+    m_pos(xml.c_str()), m_end(xml.c_str() + strlen(xml.c_str())),
+    m_target(nullptr), m_pose_level(SIZE_MAX), m_seen_attributes(0),
+    found_mascot(false), found_alt_mascot(false)
+{
+    m_open.reserve(32);
+}
+
+bool actions_scanner::is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool actions_scanner::is_name_end(char c) {
+    return is_space(c) || c == '/' || c == '>' || c == '=' || c == '<' ||
+        c == '"' || c == '\'';
+}
+
+bool actions_scanner::starts_with(const char *str) const {
+    size_t len = strlen(str);
+    return (size_t)(m_end - m_pos) >= len && memcmp(m_pos, str, len) == 0;
+}
+
+bool actions_scanner::skip_past(const char *str) {
+    size_t len = strlen(str);
+    while (m_pos + len <= m_end) {
+        auto found = (const char *)memchr(m_pos, str[0], m_end - m_pos);
+        if (found == nullptr || found + len > m_end) {
+            break;
+        }
+        if (memcmp(found, str, len) == 0) {
+            m_pos = found + len;
+            return true;
+        }
+        m_pos = found + 1;
+    }
+    m_pos = m_end;
+    return false;
+}
+
+bool actions_scanner::skip_declaration() {
+    // <!DOCTYPE ...> and similar, which may contain an internal subset
+    // in brackets and quoted strings
+    int brackets = 0;
+    while (m_pos < m_end) {
+        char c = *m_pos++;
+        if (c == '"' || c == '\'') {
+            auto quote = (const char *)memchr(m_pos, c, m_end - m_pos);
+            if (quote == nullptr) {
+                return false;
+            }
+            m_pos = quote + 1;
+        }
+        else if (c == '[') {
+            ++brackets;
+        }
+        else if (c == ']') {
+            --brackets;
+        }
+        else if (c == '>' && brackets <= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void actions_scanner::skip_spaces() {
+    while (m_pos < m_end && is_space(*m_pos)) {
+        ++m_pos;
+    }
+}
+
+name_view actions_scanner::read_name() {
+    const char *begin = m_pos;
+    while (m_pos < m_end && !is_name_end(*m_pos)) {
+        ++m_pos;
+    }
+    return { begin, (size_t)(m_pos - begin) };
+}
+
+void actions_scanner::add_path(const char *begin, const char *end) {
+    // decode entities and convert whitespace to spaces the same way an
+    // XML parser normalizes attribute values
+    std::string path;
+    path.reserve(end - begin);
+    for (const char *p = begin; p < end; ++p) {
+        char c = *p;
+        if (c == '\r') {
+            path += ' ';
+            if (p + 1 < end && p[1] == '\n') {
+                ++p;
+            }
+        }
+        else if (c == '\t' || c == '\n') {
+            path += ' ';
+        }
+        else if (c != '&') {
+            path += (char)asciitolower((unsigned char)c);
+        }
+        else {
+            auto semicolon = (const char *)memchr(p, ';', end - p);
+            if (semicolon == nullptr) {
+                path += c;
+                continue;
+            }
+            std::string entity { p + 1, semicolon };
+            uint32_t codepoint = 0;
+            bool valid = true;
+            if (entity == "amp") codepoint = '&';
+            else if (entity == "lt") codepoint = '<';
+            else if (entity == "gt") codepoint = '>';
+            else if (entity == "quot") codepoint = '"';
+            else if (entity == "apos") codepoint = '\'';
+            else if (entity.size() > 1 && entity[0] == '#') {
+                bool hex = entity[1] == 'x';
+                size_t start = hex ? 2 : 1;
+                valid = entity.size() > start;
+                for (size_t i=start; valid && i<entity.size(); ++i) {
+                    char d = entity[i];
+                    uint32_t digit;
+                    if (d >= '0' && d <= '9') digit = d - '0';
+                    else if (hex && d >= 'a' && d <= 'f') digit = d - 'a' + 10;
+                    else if (hex && d >= 'A' && d <= 'F') digit = d - 'A' + 10;
+                    else { valid = false; break; }
+                    codepoint = codepoint * (hex ? 16 : 10) + digit;
+                    valid = codepoint <= 0x10FFFF;
+                }
+            }
+            else {
+                valid = false;
+            }
+            if (!valid) {
+                path += c;
+                continue;
+            }
+            if (codepoint < 0x80) {
+                path += (char)asciitolower((unsigned char)codepoint);
+            }
+            else if (codepoint < 0x800) {
+                path += (char)(0xC0 | (codepoint >> 6));
+                path += (char)(0x80 | (codepoint & 0x3F));
+            }
+            else if (codepoint < 0x10000) {
+                path += (char)(0xE0 | (codepoint >> 12));
+                path += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+                path += (char)(0x80 | (codepoint & 0x3F));
+            }
+            else {
+                path += (char)(0xF0 | (codepoint >> 18));
+                path += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+                path += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+                path += (char)(0x80 | (codepoint & 0x3F));
+            }
+            p = semicolon;
+        }
+    }
+    m_target->insert(path);
+}
+
+bool actions_scanner::read_attributes(name_view const& element,
+    bool &self_closing)
+{
+    bool is_pose = m_target != nullptr && m_pose_level == SIZE_MAX &&
+        (element == "Pose" || element == "ポーズ");
+    m_seen_attributes = 0;
+    while (true) {
+        skip_spaces();
+        if (m_pos >= m_end) {
+            return false;
+        }
+        if (*m_pos == '>') {
+            ++m_pos;
+            self_closing = false;
+            return true;
+        }
+        if (starts_with("/>")) {
+            m_pos += 2;
+            self_closing = true;
+            return true;
+        }
+        name_view attr = read_name();
+        if (attr.size == 0) {
+            return false;
+        }
+        skip_spaces();
+        if (m_pos >= m_end || *m_pos != '=') {
+            return false;
+        }
+        ++m_pos;
+        skip_spaces();
+        if (m_pos >= m_end || (*m_pos != '"' && *m_pos != '\'')) {
+            return false;
+        }
+        char quote = *m_pos++;
+        auto value_end = (const char *)memchr(m_pos, quote, m_end - m_pos);
+        if (value_end == nullptr) {
+            return false;
+        }
+        if (is_pose) {
+            for (unsigned i=0; i<4; ++i) {
+                // only the first occurrence of an attribute counts
+                if (!(m_seen_attributes & (1U << i)) &&
+                    attr == k_pose_attributes[i])
+                {
+                    m_seen_attributes |= (1U << i);
+                    add_path(m_pos, value_end);
+                }
+            }
+        }
+        m_pos = value_end + 1;
+    }
+}
+
+void actions_scanner::scan() {
+    while (m_pos < m_end) {
+        auto tag = (const char *)memchr(m_pos, '<', m_end - m_pos);
+        if (tag == nullptr) {
+            return;
+        }
+        m_pos = tag + 1;
+        if (starts_with("!--")) {
+            if (!skip_past("-->")) return;
+        }
+        else if (starts_with("![CDATA[")) {
+            if (!skip_past("]]>")) return;
+        }
+        else if (starts_with("!")) {
+            if (!skip_declaration()) return;
+        }
+        else if (starts_with("?")) {
+            if (!skip_past("?>")) return;
+        }
+        else if (starts_with("/")) {
+            ++m_pos;
+            name_view name = read_name();
+            skip_spaces();
+            if (m_open.empty() || m_pos >= m_end || *m_pos != '>' ||
+                !(m_open.back() == name))
+            {
+                return;
+            }
+            ++m_pos;
+            m_open.pop_back();
+            if (m_open.size() == m_pose_level) {
+                m_pose_level = SIZE_MAX;
+            }
+            if (m_open.empty()) {
+                if (m_target == &mascot_paths) {
+                    // the first Mascot element is the one that is used
+                    return;
+                }
+                m_target = nullptr;
+            }
+        }
+        else {
+            name_view name = read_name();
+            if (name.size == 0) {
+                return;
+            }
+            if (m_open.empty()) {
+                if (!found_mascot && name == "Mascot") {
+                    found_mascot = true;
+                    m_target = &mascot_paths;
+                }
+                else if (!found_alt_mascot && name == "マスコット") {
+                    found_alt_mascot = true;
+                    m_target = &alt_mascot_paths;
+                }
+                else {
+                    m_target = nullptr;
+                }
+            }
+            bool self_closing;
+            if (!read_attributes(name, self_closing)) {
+                return;
+            }
+            if (self_closing) {
+                if (m_open.empty() && m_target == &mascot_paths) {
+                    return;
+                }
+                continue;
+            }
+            if (m_pose_level == SIZE_MAX && m_target != nullptr &&
+                (name == "Pose" || name == "ポーズ"))
+            {
+                m_pose_level = m_open.size();
+            }
+            m_open.push_back(name);
+        }
+    }
+}
+
+}
+
+bool scan_actions_xml(std::string const& xml, std::set<std::string> &paths) {
+    actions_scanner scanner { xml };
+    scanner.scan();
+    if (scanner.found_mascot) {
+        paths = std::move(scanner.mascot_paths);
+        return true;
+    }
+    else if (scanner.found_alt_mascot) {
+        paths = std::move(scanner.alt_mascot_paths);
+        return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <set>
+#include <string>
+
+namespace shimejifinder {
+
+/// Collects the file names referenced by the Pose elements of an
+/// actions.xml file. The file is scanned in place without building a
+/// document tree. Names are lowercased before they are added to paths.
+/// Poses nested inside other poses are ignored. If the file is malformed,
+/// the names found before the error are kept.
+/// @param xml Contents of the file. Scanning stops at the first NUL.
+/// @param paths Set that receives the file names.
+/// @return false if the file does not have a Mascot root element.
+bool scan_actions_xml(std::string const& xml, std::set<std::string> &paths);
+
+}
@@ -0,0 +1,147 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "analysis_cache.hpp"
+#include "binary_io.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace shimejifinder {
+
+// bump when the analyzer starts producing different results for the
+// same archive, so that old cache files are no longer used
+static const uint64_t k_cache_version = 1;
+
+analysis_cache::analysis_cache(std::filesystem::path const& dir,
+    size_t max_entries, uint64_t max_bytes): m_dir(dir),
+    m_max_entries(max_entries), m_max_bytes(max_bytes) {}
+
+std::string analysis_cache::key(archive const& ar, std::string const& name) {
+    uint64_t hash = ar.fingerprint();
+    hash = fnv1a(hash, &k_cache_version, sizeof(k_cache_version));
+    // the archive name is used for shimeji without a unique name
+    hash = fnv1a(hash, name.c_str(), name.size());
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    return buf;
+}
+
+std::filesystem::path analysis_cache::path_for(std::string const& key) const {
+    return m_dir / (key + ".sfa");
+}
+
+bool analysis_cache::load(std::string const& key, archive &ar) {
+    auto path = path_for(key);
+    std::ifstream in { path, std::ios::in | std::ios::binary };
+    if (!in.is_open()) {
+        return false;
+    }
+    if (!ar.read_analysis(in)) {
+        std::cerr << "shimejifinder: analysis_cache: ignoring invalid "
+            "cache file " << path << std::endl;
+        std::error_code err;
+        std::filesystem::remove(path, err);
+        return false;
+    }
+
+    // mark as recently used
+    std::error_code err;
+    std::filesystem::last_write_time(path,
+        std::filesystem::file_time_type::clock::now(), err);
+    return true;
+}
+
+void analysis_cache::store(std::string const& key, archive const& ar) {
+    std::error_code err;
+    std::filesystem::create_directories(m_dir, err);
+    if (err) {
+        std::cerr << "shimejifinder: analysis_cache: cannot create " <<
+            m_dir << ": " << err.message() << std::endl;
+        return;
+    }
+
+    // write to a temporary file first so that concurrent readers never
+    // see a partially written analysis
+    auto path = path_for(key);
+    auto tmp_path = path;
+    tmp_path += "." + std::to_string(getpid()) + "." + std::to_string(
+        std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream out { tmp_path, std::ios::out | std::ios::binary };
+        ar.write_analysis(out);
+        if (!out.good()) {
+            out.close();
+            std::filesystem::remove(tmp_path, err);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp_path, path, err);
+    if (err) {
+        std::filesystem::remove(tmp_path, err);
+        return;
+    }
+    evict();
+}
+
+void analysis_cache::evict() {
+    struct cached_file {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uint64_t size;
+    };
+    std::vector<cached_file> files;
+    uint64_t total_size = 0;
+    std::error_code err;
+    for (auto &file : std::filesystem::directory_iterator { m_dir, err }) {
+        if (!file.is_regular_file(err) || file.path().extension() != ".sfa") {
+            continue;
+        }
+        cached_file info;
+        info.path = file.path();
+        info.time = file.last_write_time(err);
+        info.size = file.file_size(err);
+        if (err) {
+            continue;
+        }
+        total_size += info.size;
+        files.push_back(info);
+    }
+
+    // remove least recently used files until both limits are satisfied
+    std::sort(files.begin(), files.end(), [](cached_file const& a,
+        cached_file const& b)
+    {
+        return a.time < b.time;
+    });
+    size_t count = files.size();
+    for (auto &file : files) {
+        if (count <= m_max_entries && total_size <= m_max_bytes) {
+            break;
+        }
+        std::filesystem::remove(file.path, err);
+        --count;
+        total_size -= file.size;
+    }
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "archive.hpp"
+#include <filesystem>
+#include <string>
+
+namespace shimejifinder {
+
+/// On-disk cache of finished analyses. Each analysis is stored in its own
+/// file named after the key. When the cache grows past its limits, the
+/// least recently used files are removed.
+class analysis_cache {
+private:
+    std::filesystem::path m_dir;
+    size_t m_max_entries;
+    uint64_t m_max_bytes;
+    std::filesystem::path path_for(std::string const& key) const;
+    void evict();
+public:
+    analysis_cache(std::filesystem::path const& dir, size_t max_entries,
+        uint64_t max_bytes);
+    static std::string key(archive const& ar, std::string const& name);
+    bool load(std::string const& key, archive &ar);
+    void store(std::string const& key, archive const& ar);
+};
+
+}
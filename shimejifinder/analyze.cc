@@ -17,6 +17,8 @@
 // 
 
 #include "analyze.hpp"
+#include "actions_scanner.hpp"
+#include "analysis_cache.hpp"
 #include "libunarr/archive.hpp"
 #include "libarchive/archive.hpp"
 #include "archive.hpp"
@@ -31,37 +33,55 @@
 #include <stdexcept>
 #include <string>
 #include <array>
-#include <pugixml.hpp>
 #include <cstring>
 #include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
 
 namespace shimejifinder {
 
-static const std::vector<std::string> k_behaviors_names =
-    { "行動.xml", "behaviors.xml", "behavior.xml", "two.xml", "2.xml" };
-static const std::vector<std::string> k_actions_names =
-    { "動作.xml", "actions.xml", "action.xml", "one.xml", "1.xml" };
-
-template<typename T>
-static std::unique_ptr<archive> open_archive(T const& input) {
+template<typename... T>
+static std::unique_ptr<archive> open_archive(analyze_config const& config,
+    T const&... input)
+{
+    using backend_type = analyze_config::backend_type;
+    uint64_t fallbacks = 0;
     #if !SHIMEJIFINDER_NO_LIBARCHIVE
-    try {
-        auto ar = std::make_unique<libarchive::archive>();
-        ar->open(input);
-        return ar;
-    }
-    catch (std::exception &ex) {
-        std::cerr << "libarchive: open(): " << ex.what() << std::endl;
+    if (config.backend != backend_type::LIBUNARR) {
+        try {
+            auto ar = std::make_unique<libarchive::archive>();
+            ar->set_config(config);
+            ar->open(input...);
+            SHIMEJIFINDER_COUNT(ar->stats().backend_fallbacks, fallbacks);
+            return ar;
+        }
+        catch (read_aborted &) {
+            // reading was stopped on purpose, another backend must not
+            // start over
+            throw;
+        }
+        catch (std::exception &ex) {
+            std::cerr << "libarchive: open(): " << ex.what() << std::endl;
+            ++fallbacks;
+        }
     }
     #endif
     #if !SHIMEJIFINDER_NO_LIBUNARR
-    try {
-        auto ar = std::make_unique<libunarr::archive>();
-        ar->open(input);
-        return ar;
-    }
-    catch (std::exception &ex) {
-        std::cerr << "libunarr: open(): " << ex.what() << std::endl;
+    if (config.backend != backend_type::LIBARCHIVE) {
+        try {
+            auto ar = std::make_unique<libunarr::archive>();
+            ar->set_config(config);
+            ar->open(input...);
+            SHIMEJIFINDER_COUNT(ar->stats().backend_fallbacks, fallbacks);
+            return ar;
+        }
+        catch (read_aborted &) {
+            throw;
+        }
+        catch (std::exception &ex) {
+            std::cerr << "libunarr: open(): " << ex.what() << std::endl;
+        }
     }
     #endif
     throw std::runtime_error("failed to open archive");
@@ -79,18 +99,46 @@ private:
         const archive_folder *root;
     };
 
+    // targets found for a shimeji, applied to the archive once all
+    // configuration files have been resolved
+    struct registration {
+        std::string name;
+        std::vector<std::pair<archive_entry *, extract_target>> targets;
+    };
+
+    // paths referenced by a configuration file, resolved at most once in
+    // every folder that is searched. shared by all shimeji that use the
+    // same configuration.
+    class path_index {
+    private:
+        std::vector<std::string> m_paths;
+        std::vector<const std::string *> m_normalized;
+        std::vector<bool> m_try_normalized;
+        std::unordered_map<const archive_folder *,
+            std::vector<archive_entry *>> m_resolved;
+    public:
+        path_index(std::set<std::string> const& paths, name_pool &names);
+        size_t size() const;
+        const std::string *normalized(size_t i) const;
+        std::vector<archive_entry *> const& resolve(
+            const archive_folder *folder);
+    };
+
     static std::set<std::string> find_paths(
         std::string const& actions_xml);
     static void add_search_paths(std::vector<const archive_folder *> &search_paths,
         const archive_folder *base);
     bool register_shimeji(const archive_folder *base,
         archive_entry *actions, archive_entry *behaviors,
-        std::set<std::string> const& paths,
-        const archive_folder *alternative_base = nullptr);
+        path_index &paths,
+        std::vector<registration> &out,
+        const archive_folder *alternative_base = nullptr) const;
     size_t discover_shimejiee(const archive_folder *img,
         archive_entry *actions, archive_entry *behaviors,
-        std::set<std::string> const& paths);
-    std::string shimeji_name(const archive_folder *base);
+        path_index &paths,
+        std::vector<registration> &out) const;
+    std::string shimeji_name(const archive_folder *base) const;
+    void apply(registration const& reg);
     void analyze();
 public:
     void analyze(std::string const& name, archive *ar,
@@ -107,9 +155,54 @@ static archive_entry *find_file(const archive_folder *folder,
     return entry;
 }
 
+analyzer::path_index::path_index(std::set<std::string> const& paths,
+    name_pool &names): m_paths(paths.begin(), paths.end())
+{
+    // normalized paths become extract names, intern them once for every
+    // shimeji that uses this configuration
+    m_normalized.reserve(m_paths.size());
+    for (auto &path : m_paths) {
+        m_normalized.push_back(names.intern(normalize_filename(path)));
+
+        // the normalized path only differs in leading slashes if the
+        // path does not point into a subfolder, and resolves to the
+        // same file
+        auto first = path.find_first_not_of('/');
+        m_try_normalized.push_back(first != std::string::npos &&
+            path.find('/', first) != std::string::npos);
+    }
+}
+
+size_t analyzer::path_index::size() const {
+    return m_paths.size();
+}
+
+const std::string *analyzer::path_index::normalized(size_t i) const {
+    return m_normalized[i];
+}
+
+std::vector<archive_entry *> const& analyzer::path_index::resolve(
+    const archive_folder *folder)
+{
+    auto iter = m_resolved.find(folder);
+    if (iter != m_resolved.end()) {
+        return iter->second;
+    }
+    std::vector<archive_entry *> resolved(m_paths.size());
+    for (size_t i=0; i<m_paths.size(); ++i) {
+        auto entry = folder->relative_file(m_paths[i]);
+        if (entry == nullptr && m_try_normalized[i]) {
+            entry = folder->relative_file(*m_normalized[i]);
+        }
+        resolved[i] = entry;
+    }
+    return m_resolved.emplace(folder, std::move(resolved)).first->second;
+}
+
 size_t analyzer::discover_shimejiee(const archive_folder *img,
     archive_entry *actions, archive_entry *behaviors,
-    std::set<std::string> const& paths)
+    path_index &paths,
+    std::vector<registration> &out) const
 {
     size_t associated = 0;
     for (auto const& pair : img->folders()) {
@@ -126,7 +219,7 @@ size_t analyzer::discover_shimejiee(const archive_folder *img,
         }
         
         bool found = register_shimeji(folder, actions, behaviors,
-            paths, img);
+            paths, out, img);
         if (found) {
             ++associated;
         }
@@ -137,24 +230,27 @@ size_t analyzer::discover_shimejiee(const archive_folder *img,
 void analyzer::add_search_paths(std::vector<const archive_folder *>
     &search_paths, const archive_folder *base)
 {
-    search_paths.push_back( base );
-    search_paths.push_back( base->folder_named("img") );
-    search_paths.push_back( base->folder_named("sound") );
-    search_paths.push_back( base->parent() );
-    search_paths.push_back( base->parent()->folder_named("img") );
-    search_paths.push_back( base->parent()->folder_named("sound") );
-    search_paths.push_back( base->parent()->parent() );
-    search_paths.push_back( base->parent()->parent()->folder_named("img") );
-    search_paths.push_back( base->parent()->parent()->folder_named("sound") );
-    search_paths.push_back( base->parent()->parent()->parent() );
-    search_paths.push_back( base->parent()->parent()->parent()->folder_named("img") );
-    search_paths.push_back( base->parent()->parent()->parent()->folder_named("sound") );
+    auto add = [&search_paths](const archive_folder *folder) {
+        // skip missing and duplicate folders
+        if (folder != nullptr && std::find(search_paths.begin(),
+            search_paths.end(), folder) == search_paths.end())
+        {
+            search_paths.push_back(folder);
+        }
+    };
+    for (int i=0; i<4; ++i) {
+        add( base );
+        add( base->folder_named("img") );
+        add( base->folder_named("sound") );
+        base = base->parent();
+    }
 }
 
 bool analyzer::register_shimeji(const archive_folder *base,
     archive_entry *actions, archive_entry *behaviors,
-    std::set<std::string> const& paths,
-    const archive_folder *alternative_base)
+    path_index &paths,
+    std::vector<registration> &out,
+    const archive_folder *alternative_base) const
 {
     auto name = shimeji_name(base);
     std::vector<const archive_folder *> search_paths;
@@ -163,43 +259,14 @@ bool analyzer::register_shimeji(const archive_folder *base,
         add_search_paths(search_paths, alternative_base);
     }
 
-    // de-duplicate search paths
-    for (size_t i=0; i<search_paths.size(); ++i) {
-        if (search_paths[i] == nullptr) {
-            search_paths.erase(search_paths.begin() + i);
-            --i;
-        }
-        else {
-            for (size_t j=search_paths.size()-1; j>i; --j) {
-                if (search_paths[i] == search_paths[j]) {
-                    search_paths.erase(search_paths.begin() + j);
-                }
-            }
-        }
-    }
-    
-    std::vector<std::pair<archive_entry *, std::string>> targets(paths.size(),
-        { nullptr, "" });
+    std::vector<archive_entry *> targets(paths.size(), nullptr);
     bool has_images = false;
     for (auto search : search_paths) {
-        if (search == nullptr) {
-            continue;
-        }
-        auto path_iter = paths.cbegin();
-        for (size_t j=0; j<targets.size(); ++j, ++path_iter) {
-            auto &file = targets[j];
-            if (file.first != nullptr) {
-                continue;
-            }
-            auto &path = *path_iter;
-            auto entry = search->relative_file(path);
-            if (entry == nullptr) {
-                entry = search->relative_file(normalize_filename(path));
-            }
-            if (entry != nullptr) {
-                file.first = entry;
-                file.second = normalize_filename(path);
-                if (file.first->lower_extension() == "png") {
+        auto &resolved = paths.resolve(search);
+        for (size_t j=0; j<targets.size(); ++j) {
+            if (targets[j] == nullptr && resolved[j] != nullptr) {
+                targets[j] = resolved[j];
+                if (targets[j]->type() == extract_target::extract_type::IMAGE) {
                     has_images = true;
                 }
             }
@@ -208,29 +275,41 @@ bool analyzer::register_shimeji(const archive_folder *base,
     if (!has_images) {
         return false;
     }
-    for (auto target : targets) {
-        if (target.first == nullptr) {
+    registration reg;
+    reg.name = name;
+    auto &names = m_ar->names();
+    auto interned_name = names.intern(name);
+    for (size_t j=0; j<targets.size(); ++j) {
+        auto entry = targets[j];
+        if (entry == nullptr) {
             continue;
         }
         extract_target::extract_type type;
-        auto entry = target.first;
-        auto &normalized_path = target.second;
-        if (entry->lower_extension() == "png") {
+        auto normalized_path = paths.normalized(j);
+        if (entry->type() == extract_target::extract_type::IMAGE) {
             type = extract_target::extract_type::IMAGE;
         }
-        else /* if (entry->lower_extension() == "wav") */ {
+        else /* if (entry->type() == extract_target::extract_type::SOUND) */ {
             type = extract_target::extract_type::SOUND;
         }
-        entry->add_target({ name, normalized_path, type });
+        reg.targets.push_back({ entry, { interned_name, normalized_path,
+            type } });
     }
-    actions->add_target({ name, "actions.xml",
-        extract_target::extract_type::XML });
-    behaviors->add_target({ name, "behaviors.xml",
-        extract_target::extract_type::XML });
-    m_ar->add_shimeji(name);
+    reg.targets.push_back({ actions, { interned_name,
+        names.intern("actions.xml"), extract_target::extract_type::XML } });
+    reg.targets.push_back({ behaviors, { interned_name,
+        names.intern("behaviors.xml"), extract_target::extract_type::XML } });
+    out.push_back(std::move(reg));
     return true;
 }
 
+void analyzer::apply(registration const& reg) {
+    for (auto &target : reg.targets) {
+        target.first->add_target(target.second);
+    }
+    m_ar->add_shimeji(reg.name);
+}
+
 static std::string strip_mascot_ext(std::string const& str) {
     static const std::string suffix = ".mascot";
     if (str.size() >= suffix.size() &&
@@ -241,8 +320,8 @@ static std::string strip_mascot_ext(std::string const& str) {
     return str;
 }
 
-std::string analyzer::shimeji_name(const archive_folder *base) {
-    static std::set<std::string> blacklist = {
+std::string analyzer::shimeji_name(const archive_folder *base) const {
+    static const std::set<std::string> blacklist = {
         "img", "conf", "shimeji", "unused", "shimeji-ee",
         "shimejiee", "src", "/", ".", "..", "" };
     const archive_folder *cwd = base;
@@ -270,60 +349,13 @@ std::string analyzer::shimeji_name(const archive_folder *base) {
 std::set<std::string> analyzer::find_paths(
     std::string const& actions_xml)
 {
-    try {
-        pugi::xml_document doc;
-        doc.load_string(actions_xml.c_str(), pugi::parse_default);
-        auto mascot = doc.child("Mascot");
-        if (mascot == nullptr)
-            mascot = doc.child("マスコット");
-        if (mascot == nullptr) {
-            std::cerr << "shimejifinder: not a mascot file" << std::endl;
-            return {};
-        }
-        
-        // find file names for referenced images and sounds
-        std::set<std::string> paths;
-        std::vector<pugi::xml_node> search_next = { mascot };
-        while (!search_next.empty()) {
-            size_t size = search_next.size();
-            for (size_t i=0; i<size; ++i) {
-                pugi::xml_node node = search_next[i];
-                auto name = node.name();
-                
-                if (name != NULL && (strcmp(name, "Pose") == 0 ||
-                    strcmp(name, "ポーズ") == 0))
-                {
-                    static const std::vector<std::string> attr_names =
-                        { "画像", "Image", "ImageRight", "Sound" };
-                    for (auto &attr_name : attr_names) {
-                        auto attr = node.attribute(attr_name);
-                        if (!attr.empty()) {
-                            paths.insert(to_lower(attr.as_string()));
-                        }
-                    }
-                }
-                else {
-                    // breadth-first search
-                    for (auto child : node.children()) {
-                        if (child.type() == pugi::xml_node_type::node_element) {
-                            search_next.push_back(child);
-                        }
-                    }
-                }
-            }
-            search_next.erase(search_next.begin(),
-                search_next.begin() + size);
-        }
-
-        return paths;
-    }
-    catch (std::exception &ex) {
-        std::cerr << "shimejifinder: find_paths() failed: " << ex.what() << std::endl;
+    // find file names for referenced images and sounds
+    std::set<std::string> paths;
+    if (!scan_actions_xml(actions_xml, paths)) {
+        std::cerr << "shimejifinder: not a mascot file" << std::endl;
+        return {};
     }
-    catch (...) {
-        std::cerr << "shimejifinder: find_paths() failed" << std::endl;
-    }
-    return {};
+    return paths;
 }
 
 void analyzer::analyze() {
@@ -332,63 +364,97 @@ void analyzer::analyze() {
     std::vector<const archive_folder *> search_next = { &root };
     std::vector<const archive_folder *> shime1_roots;
 
-    // find actions/behaviors pairs and shime1.png files
-    while (!search_next.empty()) {
-        size_t size = search_next.size();
-        for (size_t i=0; i<size; ++i) {
-            auto folder = search_next[i];
-
-            // breadth-first search
-            for (auto &subfolder_pair : folder->folders()) {
-                search_next.push_back(&subfolder_pair.second);
-            }
-
-            // find shime1.png
-            archive_entry *shime1 = folder->entry_named("shime1.png");
-            if (shime1 != nullptr) {
-                shime1_roots.push_back(folder);
-            }
+    // find actions/behaviors pairs and shime1.png files. breadth-first
+    // search, folders are visited in the order they are queued
+    for (size_t i=0; i<search_next.size(); ++i) {
+        auto folder = search_next[i];
+        for (auto &subfolder_pair : folder->folders()) {
+            search_next.push_back(&subfolder_pair.second);
+        }
 
-            // find behaviors file
-            archive_entry *behaviors = find_file(folder, k_behaviors_names);
-            if (behaviors == nullptr) {
-                continue;
-            }
-            
-            // find actions file
-            archive_entry *actions = find_file(folder, k_actions_names);
-            if (actions == nullptr) {
-                continue;
-            }
+        // find shime1.png
+        archive_entry *shime1 = folder->entry_named("shime1.png");
+        if (shime1 != nullptr) {
+            shime1_roots.push_back(folder);
+        }
 
-            // there is a shimeji here, actions file will be extracted in
-            // the next step
-            unparsed_xml_pair pair;
-            pair.actions = actions;
-            pair.behaviors = behaviors;
-            pair.root = folder;
-            unparsed.push_back(pair);
+        // find behaviors file
+        archive_entry *behaviors = find_file(folder, k_behaviors_names);
+        if (behaviors == nullptr) {
+            continue;
+        }
+        
+        // find actions file
+        archive_entry *actions = find_file(folder, k_actions_names);
+        if (actions == nullptr) {
+            continue;
         }
-        search_next.erase(search_next.begin(), search_next.begin() + size);
+
+        // there is a shimeji here, actions file will be extracted in
+        // the next step
+        unparsed_xml_pair pair;
+        pair.actions = actions;
+        pair.behaviors = behaviors;
+        pair.root = folder;
+        unparsed.push_back(pair);
     }
 
-    // extract actions
+    // extract actions that were not captured while listing the archive
     memory_extractor extractor;
+    bool needs_extract = false;
     for (size_t i=0; i<unparsed.size(); ++i) {
-        unparsed[i].actions->add_target({ std::to_string(i) });
+        if (!m_ar->has_captured(unparsed[i].actions->index())) {
+            unparsed[i].actions->add_target({ m_ar->names(), "",
+                std::to_string(i), extract_target::extract_type::UNSPECIFIED });
+            needs_extract = true;
+        }
+    }
+    if (needs_extract) {
+        #if !SHIMEJIFINDER_NO_STATS
+            // report this pass separately from extraction by the caller
+            auto &stats = m_ar->stats();
+            phase_stats extract_before = stats.extract;
+            m_ar->extract(&extractor);
+            stats.xml_extract.wall_ns += stats.extract.wall_ns -
+                extract_before.wall_ns;
+            stats.xml_extract.cpu_ns += stats.extract.cpu_ns -
+                extract_before.cpu_ns;
+            stats.extract = extract_before;
+        #else
+            m_ar->extract(&extractor);
+        #endif
     }
-    m_ar->extract(&extractor);
 
-    // determine which shimeji to extract based on these actions
+    std::vector<std::string const *> actions_xmls;
     for (size_t i=0; i<unparsed.size(); ++i) {
         auto &unparsed_pair = unparsed[i];
         unparsed_pair.actions->clear_targets();
-        auto &actions_xml = extractor.data(std::to_string(i));
+        int actions_idx = unparsed_pair.actions->index();
+        actions_xmls.push_back(m_ar->has_captured(actions_idx) ?
+            &m_ar->captured(actions_idx) : &extractor.data(std::to_string(i)));
+    }
+
+    // determine which shimeji to extract based on these actions. each
+    // configuration is parsed and resolved independently, results are
+    // applied afterwards in the same order as a serial run would
+    std::vector<std::vector<registration>> registrations(unparsed.size());
+    #if !SHIMEJIFINDER_NO_STATS
+        std::vector<archive_stats> item_stats(unparsed.size());
+    #endif
+    parallel_for(unparsed.size(), m_config.analyze_threads, [&](size_t i){
+        auto &unparsed_pair = unparsed[i];
+        auto &out = registrations[i];
 
         // find paths referenced in the xml
-        auto paths = find_paths(actions_xml);
+        std::set<std::string> found;
+        {
+            SHIMEJIFINDER_TIME_PHASE(item_stats[i].find_paths);
+            found = find_paths(*actions_xmls[i]);
+        }
+        SHIMEJIFINDER_TIME_PHASE(item_stats[i].path_resolution);
+        path_index paths { found, m_ar->names() };
         if (paths.size() == 0) {
-            continue;
+            return;
         }
 
         // if this folder is named conf and ../img exists, then
@@ -398,14 +464,26 @@ void analyzer::analyze() {
             auto img = unparsed_pair.root->parent()->folder_named("img");
             if (img != nullptr) {
                 has_associated = discover_shimejiee(img,
-                    unparsed_pair.actions, unparsed_pair.behaviors, paths);
+                    unparsed_pair.actions, unparsed_pair.behaviors, paths,
+                    out);
             }
         }
 
         if (has_associated == 0) {
             register_shimeji(unparsed_pair.root,
                 unparsed_pair.actions, unparsed_pair.behaviors,
-                paths);
+                paths, out);
+        }
+    });
+    #if !SHIMEJIFINDER_NO_STATS
+        for (auto &item : item_stats) {
+            m_ar->stats().find_paths += item.find_paths;
+            m_ar->stats().path_resolution += item.path_resolution;
+        }
+    #endif
+    for (auto &list : registrations) {
+        for (auto &reg : list) {
+            apply(reg);
         }
     }
 
@@ -433,12 +511,16 @@ void analyzer::analyze() {
         }
         auto name = shimeji_name(shime1_root);
         for (i=0; i<46; ++i) {
-            shimes[i]->add_target({ name, "shime" + std::to_string(i+1) + ".png",
+            shimes[i]->add_target({ m_ar->names(), name,
+                "shime" + std::to_string(i+1) + ".png",
                 extract_target::extract_type::IMAGE });
             m_ar->add_default_xml_targets(name);
         }
         m_ar->add_shimeji(name);
     }
+
+    // captured configuration files are no longer needed
+    m_ar->clear_captured();
 }
 
 void analyzer::analyze(std::string const& name, archive *ar,
@@ -448,13 +530,25 @@ void analyzer::analyze(std::string const& name, archive *ar,
     m_ar = ar;
     m_config = config;
 
+    if (m_config.cache_dir.empty()) {
+        analyze();
+        return;
+    }
+    analysis_cache cache { m_config.cache_dir, m_config.cache_max_entries,
+        m_config.cache_max_bytes };
+    auto key = analysis_cache::key(*m_ar, m_name);
+    if (cache.load(key, *m_ar)) {
+        m_ar->clear_captured();
+        return;
+    }
     analyze();
+    cache.store(key, *m_ar);
 }
 
 std::unique_ptr<archive> analyze(std::string const& name, std::string const& filename,
     analyze_config const& config)
 {
-    auto ar = open_archive(filename);
+    auto ar = open_archive(config, filename);
     analyzer{}.analyze(name, ar.get(), config);
     return ar;
 }
@@ -469,7 +563,7 @@ std::unique_ptr<archive> analyze(std::string const& filename,
 std::unique_ptr<archive> analyze(std::string const& name, std::function<FILE *()> file_open,
     analyze_config const& config)
 {
-    auto ar = open_archive(file_open);
+    auto ar = open_archive(config, file_open);
     analyzer{}.analyze(name, ar.get(), config);
     return ar;
 }
@@ -482,4 +576,103 @@ std::unique_ptr<archive> analyze(std::string const& name, std::function<int ()>
     }, config);
 }
 
+std::unique_ptr<archive> analyze(std::string const& name, const uint8_t *data,
+    size_t size, analyze_config const& config)
+{
+    auto ar = open_archive(config, data, size);
+    analyzer{}.analyze(name, ar.get(), config);
+    return ar;
+}
+
+std::unique_ptr<archive> analyze(std::string const& name,
+    std::shared_ptr<const std::vector<uint8_t>> data,
+    analyze_config const& config)
+{
+    auto ar = open_archive(config, data);
+    analyzer{}.analyze(name, ar.get(), config);
+    return ar;
+}
+
+template<typename T>
+static std::unique_ptr<archive> load_plan_any(std::istream &in, T const& input) {
+    // the backend is recorded in the plan, try each backend until one
+    // accepts it
+    std::string plan { std::istreambuf_iterator<char>(in),
+        std::istreambuf_iterator<char>() };
+    #if !SHIMEJIFINDER_NO_LIBARCHIVE
+    {
+        std::istringstream ss { plan };
+        auto ar = std::make_unique<libarchive::archive>();
+        if (ar->load_plan(ss, input)) {
+            return ar;
+        }
+    }
+    #endif
+    #if !SHIMEJIFINDER_NO_LIBUNARR
+    {
+        std::istringstream ss { plan };
+        auto ar = std::make_unique<libunarr::archive>();
+        if (ar->load_plan(ss, input)) {
+            return ar;
+        }
+    }
+    #endif
+    throw std::runtime_error("failed to load plan");
+}
+
+std::unique_ptr<archive> load_plan(std::istream &in, std::string const& filename) {
+    return load_plan_any(in, filename);
+}
+
+std::unique_ptr<archive> load_plan(std::istream &in, std::function<FILE *()> file_open) {
+    return load_plan_any(in, file_open);
+}
+
+std::vector<batch_result> analyze_batch(std::vector<batch_job> const& jobs,
+    size_t threads, analyze_config const& config)
+{
+    // schedule the largest archives first
+    std::vector<std::pair<uintmax_t, size_t>> order;
+    for (size_t i=0; i<jobs.size(); ++i) {
+        std::error_code err;
+        uintmax_t size = std::filesystem::file_size(jobs[i].filename, err);
+        order.emplace_back(err ? 0 : size, i);
+    }
+    std::stable_sort(order.begin(), order.end(), [](auto const& a,
+        auto const& b)
+    {
+        return a.first > b.first;
+    });
+
+    std::vector<batch_result> results(jobs.size());
+    parallel_for(order.size(), threads, [&](size_t i){
+        size_t idx = order[i].second;
+        auto &job = jobs[idx];
+        auto &result = results[idx];
+        try {
+            std::unique_ptr<archive> ar;
+            if (job.name.empty()) {
+                ar = analyze(job.filename, config);
+            }
+            else {
+                ar = analyze(job.name, job.filename, config);
+            }
+            result.shimejis = ar->shimejis();
+            if (!job.output.empty()) {
+                ar->extract(job.output);
+            }
+            else {
+                result.ar = std::move(ar);
+            }
+        }
+        catch (std::exception &ex) {
+            result.error = ex.what();
+        }
+        catch (...) {
+            result.error = "unknown error";
+        }
+    });
+    return results;
+}
+
 }
@@ -19,23 +19,26 @@
 // 
 
 #include "archive.hpp"
+#include "analyze_config.hpp"
 #include <memory>
 #include <functional>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <set>
 
 namespace shimejifinder {
 
-struct analyze_config {
-    bool unused = false;
-};
-
 /// Analyzes the specified archive file and returns an archive object ready
-/// to be extracted, or null if an error occurred.
+/// to be extracted, or null if an error occurred. Throws limit_exceeded if
+/// the archive exceeds one of the limits in config.
 /// @param filename Path to archive.
 /// @param config Analyzer configuration.
 std::unique_ptr<archive> analyze(std::string const& filename, analyze_config const& config = {});
 
 /// Analyzes the specified archive file and returns an archive object ready
-/// to be extracted, or null if an error occurred.
+/// to be extracted, or null if an error occurred. Throws limit_exceeded if
+/// the archive exceeds one of the limits in config.
 /// @param name User-friendly name of the archive. Usually the archive's
 ///             filename without its extension. Will be used as fallbac
 ///             when a shimeji's name cannot be determined.
@@ -45,7 +48,8 @@ std::unique_ptr<archive> analyze(std::string const& name, std::string const& fil
     analyze_config const& config = {});
 
 /// Analyzes the specified archive file and returns an archive object ready
-/// to be extracted, or null if an error occurred.
+/// to be extracted, or null if an error occurred. Throws limit_exceeded if
+/// the archive exceeds one of the limits in config.
 /// @param name User-friendly name of the archive. Usually the archive's
 ///             filename without its extension. Will be used as fallbac
 ///             when a shimeji's name cannot be determined.
@@ -56,7 +60,8 @@ std::unique_ptr<archive> analyze(std::string const& name, std::function<FILE *()
     analyze_config const& config = {});
 
 /// Analyzes the specified archive file and returns an archive object ready
-/// to be extracted, or null if an error occurred.
+/// to be extracted, or null if an error occurred. Throws limit_exceeded if
+/// the archive exceeds one of the limits in config.
 /// @param name User-friendly name of the archive. Usually the archive's
 ///             filename without its extension. Will be used as fallbac
 ///             when a shimeji's name cannot be determined.
@@ -66,4 +71,86 @@ std::unique_ptr<archive> analyze(std::string const& name, std::function<FILE *()
 std::unique_ptr<archive> analyze(std::string const& name, std::function<int ()> file_open,
     analyze_config const& config = {});
 
+/// Analyzes an archive that is already in memory and returns an archive
+/// object ready to be extracted, or null if an error occurred. Throws
+/// limit_exceeded if the archive exceeds one of the limits in config.
+/// @param name User-friendly name of the archive. Will be used as fallback
+///             when a shimeji's name cannot be determined.
+/// @param data Contents of the archive. Not copied, must stay valid until
+///             the returned archive is destroyed.
+/// @param size Size of data in bytes.
+/// @param config Analyzer configuration.
+std::unique_ptr<archive> analyze(std::string const& name, const uint8_t *data, size_t size,
+    analyze_config const& config = {});
+
+/// Analyzes an archive that is already in memory and returns an archive
+/// object ready to be extracted, or null if an error occurred. Throws
+/// limit_exceeded if the archive exceeds one of the limits in config.
+/// @param name User-friendly name of the archive. Will be used as fallback
+///             when a shimeji's name cannot be determined.
+/// @param data Contents of the archive. Not copied, the returned archive
+///             keeps a reference to it.
+/// @param config Analyzer configuration.
+std::unique_ptr<archive> analyze(std::string const& name,
+    std::shared_ptr<const std::vector<uint8_t>> data, analyze_config const& config = {});
+
+/// Restores an archive from a plan written by archive::save_plan(). The
+/// returned archive is ready to be extracted without being analyzed
+/// again. Throws if the plan is invalid or was made for another archive.
+/// The archive is listed once to check this. Zip files are listed from
+/// their central directory, which reads little more than the directory.
+/// Other formats, and zip files that contain archives, cost a full
+/// listing pass, which may decompress the archive.
+/// @param in Stream containing the plan.
+/// @param filename Path to the archive the plan was created from.
+std::unique_ptr<archive> load_plan(std::istream &in, std::string const& filename);
+
+/// Restores an archive from a plan written by archive::save_plan(). The
+/// returned archive is ready to be extracted without being analyzed
+/// again. Throws if the plan is invalid or was made for another archive.
+/// The archive is listed once to check this. Zip files are listed from
+/// their central directory, which reads little more than the directory.
+/// Other formats, and zip files that contain archives, cost a full
+/// listing pass, which may decompress the archive.
+/// @param in Stream containing the plan.
+/// @param file_open Callback to open the archive file the plan was
+///                  created from.
+std::unique_ptr<archive> load_plan(std::istream &in, std::function<FILE *()> file_open);
+
+struct batch_job {
+    /// User-friendly name of the archive. If empty, the filename without
+    /// its extension is used.
+    std::string name;
+
+    /// Path to archive.
+    std::string filename;
+
+    /// Directory to extract the shimeji into. If empty, the archive is
+    /// only analyzed.
+    std::filesystem::path output;
+};
+
+struct batch_result {
+    /// Analyzed archive. Only kept for jobs without an output directory,
+    /// and null if an error occurred.
+    std::unique_ptr<archive> ar;
+
+    /// Shimeji found in the archive.
+    std::set<std::string> shimejis;
+
+    /// Error message, empty if the job succeeded.
+    std::string error;
+};
+
+/// Analyzes and extracts multiple archives concurrently. Larger archives
+/// are started first so that a single large archive does not delay the
+/// whole batch.
+/// @param jobs Archives to process.
+/// @param threads Number of worker threads. If 0, one thread per hardware
+///                thread is used.
+/// @param config Analyzer configuration, used for every archive.
+/// @return One result per job, in the same order as jobs.
+std::vector<batch_result> analyze_batch(std::vector<batch_job> const& jobs,
+    size_t threads = 0, analyze_config const& config = {});
+
 }
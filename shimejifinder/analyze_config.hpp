@@ -0,0 +1,161 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "progress.hpp"
+
+namespace shimejifinder {
+
+struct analyze_config {
+    enum class backend_type {
+        /// libarchive, falling back to libunarr if it cannot open the
+        /// archive.
+        AUTO,
+        LIBARCHIVE,
+        LIBUNARR
+    };
+
+    /// Backend used to read the archive. If the backend is not available
+    /// in this build, opening fails.
+    backend_type backend = backend_type::AUTO;
+
+    /// Maximum number of bytes of actions/behaviors XML files that will be
+    /// kept in memory while the archive is being listed. Files that do not
+    /// fit are extracted in a separate pass during analysis. Set to 0 to
+    /// disable.
+    size_t xml_capture_limit = 16 * 1024 * 1024;
+
+    /// Keep the contents of every png, wav and xml entry while the archive
+    /// is being listed. extract() is then served from these contents and
+    /// does not read the archive again. Recommended for small and medium
+    /// sized archives.
+    bool retain_payloads = false;
+
+    /// Use the central directory of zip files to list them without going
+    /// through the whole file, and to read the needed entries directly
+    /// when a small part of the archive is extracted.
+    bool random_access = true;
+
+    /// Map the archive file into memory when it is first read and serve
+    /// every later pass and thread from the mapping instead of opening the
+    /// file again. The file must not be truncated until the archive is
+    /// closed. Ignored if the file cannot be mapped, for example because
+    /// it is a pipe.
+    bool map_input = true;
+
+    /// Number of decompressed blocks that may wait to be written during
+    /// extract(). If non-zero, the archive is read on the calling thread
+    /// and the extractor is called on a separate thread, so reading and
+    /// writing overlap. Useful when the extractor writes to slow storage.
+    size_t write_queue_blocks = 0;
+
+    /// Number of threads used by extract() to decompress zip entries that
+    /// can be read directly, see random_access. Each thread reads the
+    /// file on its own and entries are passed to the extractor one at a
+    /// time, in no particular order. If 0, one thread per hardware thread
+    /// is used.
+    size_t extract_threads = 1;
+
+    /// Maximum number of bytes of retained contents kept in memory. Contents
+    /// that do not fit are written to a temporary file.
+    size_t payload_memory_limit = 32 * 1024 * 1024;
+
+    /// Directory for the temporary files used by retain_payloads, by
+    /// nested_cache_limit and for nested 7z and rar archives, which are
+    /// copied out of their parent before they are read. If empty, an
+    /// anonymous memory file is used where available, otherwise tmpfile().
+    std::string payload_spill_dir;
+
+    /// Maximum size of a nested 7z or rar archive copied to an anonymous
+    /// memory file. Memory files cannot be swapped out, larger archives
+    /// are moved to tmpfile() while they are copied. Only used if
+    /// payload_spill_dir is empty or unusable.
+    uint64_t spill_memory_limit = 64 * 1024 * 1024;
+
+    /// Maximum number of bytes of nested archives kept after they are
+    /// listed. Later passes over the archive, such as extract(), read
+    /// nested archives from these copies instead of decompressing them
+    /// from their parent again. Copies are kept in payload_spill_dir, or
+    /// in memory files of at most spill_memory_limit bytes each if it is
+    /// empty, for as long as the archive is open. Disabled if 0.
+    uint64_t nested_cache_limit = 0;
+
+    /// Number of threads used to parse configuration files and resolve
+    /// the files they reference. If 0, one thread per hardware thread is
+    /// used. The result does not depend on the number of threads.
+    size_t analyze_threads = 1;
+
+    /// Directory for the persistent analysis cache. When set, finished
+    /// analyses are stored there keyed by the archive's listing, and later
+    /// analyses of the same archive are loaded from it. Disabled if empty.
+    std::string cache_dir;
+
+    /// Maximum number of analyses kept in the cache. Least recently used
+    /// analyses are removed first.
+    size_t cache_max_entries = 4096;
+
+    /// Maximum total size of the cache in bytes.
+    uint64_t cache_max_bytes = 256 * 1024 * 1024;
+
+    // The limits below protect against broken and malicious archives.
+    // Reading stops as soon as one of them is reached and
+    // shimejifinder::limit_exceeded is thrown. A value of 0 disables the
+    // limit. Valid archives can be large or compress well, so apart from
+    // the nesting depth they are disabled unless set. Callers reading
+    // untrusted archives should set them, for example to 100000 files,
+    // 2 GiB and a ratio of 100.
+
+    /// Maximum number of files in the archive, including the files in
+    /// nested archives. Directories and other entries that are not
+    /// regular files are not counted.
+    size_t max_entries = 0;
+
+    /// Maximum number of bytes decompressed while listing or extracting
+    /// the archive. Nested archives count towards this limit both as
+    /// entries of their parent and as archives of their own.
+    uint64_t max_total_bytes = 0;
+
+    /// Maximum ratio between the decompressed and the compressed size of
+    /// a single entry. The compressed size is estimated from the input
+    /// read while decompressing, so small entries are never rejected.
+    uint64_t max_compression_ratio = 0;
+
+    /// Maximum number of archives nested inside each other.
+    size_t max_nesting_depth = 4;
+
+    /// Maximum time in milliseconds spent listing the archive, and again
+    /// for extracting it.
+    uint64_t max_wall_time_ms = 0;
+
+    /// Called after every entry and data block while the archive is
+    /// listed and extracted, on the thread that reads the archive. Keep
+    /// it cheap. analyze_batch() calls it from its worker threads.
+    std::function<void (progress const&)> progress_callback;
+
+    /// Checked after every entry and data block. Once it is cancelled,
+    /// reading stops and shimejifinder::operation_cancelled is thrown.
+    std::shared_ptr<cancellation_token> cancellation;
+};
+
+}
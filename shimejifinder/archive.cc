@@ -25,6 +25,10 @@
 #include <fstream>
 #include <cstdint>
 #include "fs_extractor.hpp"
+#include "binary_io.hpp"
+#include "utils.hpp"
+#include "utf8_convert.hpp"
+#include <sys/stat.h>
 
 #include "default_actions.cc"
 #include "default_behaviors.cc"
@@ -32,24 +36,57 @@
 
 namespace shimejifinder {
 
-void archive::add_entry(archive_entry const& entry) {
-    static const std::set<std::string> allowed_extensions =
-        { "wav", "png", "xml" };
-    if (allowed_extensions.count(entry.lower_extension()) == 1) {
-        m_entries.push_back(std::make_shared<archive_entry>(entry));
+archive_entry *archive::add_entry(int index, std::string const& path) {
+    SHIMEJIFINDER_COUNT(m_stats.entries_seen, 1);
+    if (m_fingerprint_only) {
+        return nullptr;
     }
+    auto name = std::string_view { path }.substr(path.rfind('/') + 1);
+    std::string lower_name;
+    if (name.size() >= 4) {
+        // only the extension decides if the entry is kept
+        lower_name = to_lower(std::string { name.substr(name.size() - 4) });
+    }
+    if (archive_entry::type_for_name(lower_name) ==
+        extract_target::extract_type::UNSPECIFIED)
+    {
+        return nullptr;
+    }
+    SHIMEJIFINDER_COUNT(m_stats.entries_kept, 1);
+    return m_entries.add(index, path);
 }
 
 void archive::begin_write(extract_target const& entry) {
+    if (m_pipeline != nullptr) {
+        m_pipeline->begin_write(entry);
+        return;
+    }
+    SHIMEJIFINDER_TIME_BLOCKS(m_stats.writes);
     m_extractor->begin_write(entry);
 }
 
 void archive::write_next(size_t offset, const void *buf, size_t size) {
+    if (m_pipeline != nullptr) {
+        m_pipeline->write_next(offset, buf, size);
+        return;
+    }
+    SHIMEJIFINDER_TIME_BLOCKS(m_stats.writes);
+    SHIMEJIFINDER_COUNT(m_stats.bytes_written, size);
     m_extractor->write_next(offset, buf, size);
 }
 
 void archive::end_write() {
-    m_extractor->end_write();
+    if (m_pipeline != nullptr) {
+        m_pipeline->end_write();
+    }
+    else {
+        SHIMEJIFINDER_TIME_BLOCKS(m_stats.writes);
+        m_extractor->end_write();
+    }
+    if (m_progress.stage == progress::stage_type::EXTRACTING) {
+        ++m_progress.entries;
+        report_progress(m_progress.bytes);
+    }
 }
 
 void archive::write_target(extract_target const& target, uint8_t *buf, size_t size) {
@@ -58,16 +95,423 @@ void archive::write_target(extract_target const& target, uint8_t *buf, size_t si
     end_write();
 }
 
+size_t archive::capture_limit(archive_entry const& entry) const {
+    if (m_captured_size >= m_config.xml_capture_limit) {
+        return 0;
+    }
+    if (!is_config_filename(entry.lower_name())) {
+        return 0;
+    }
+    return m_config.xml_capture_limit - m_captured_size;
+}
+
+void archive::capture(int idx, std::string const& data) {
+    m_captured_size += data.size();
+    m_captured[idx] = data;
+}
+
+bool archive::retains_payloads() const {
+    return m_payloads_complete;
+}
+
+void archive::begin_retain(int idx, uint64_t size_hint) {
+    if (!m_payloads.begin(idx, size_hint)) {
+        m_payloads_complete = false;
+    }
+}
+
+void archive::retain_next(uint64_t offset, const void *buf, size_t size) {
+    if (!m_payloads.write_next(offset, buf, size)) {
+        m_payloads_complete = false;
+    }
+}
+
+void archive::end_retain(bool success) {
+    m_payloads.end(success);
+    if (!success) {
+        m_payloads_complete = false;
+    }
+}
+
+nested_cache &archive::nested_archives() {
+    return m_nested_archives;
+}
+
+void archive::add_fingerprint(std::string const& path, int64_t size,
+    int64_t mtime)
+{
+    m_fingerprint = fnv1a(m_fingerprint, path.c_str(), path.size() + 1);
+    m_fingerprint = fnv1a(m_fingerprint, &size, sizeof(size));
+    m_fingerprint = fnv1a(m_fingerprint, &mtime, sizeof(mtime));
+}
+
+uint64_t archive::input_size() const {
+    uint64_t size = 0;
+    if (has_filename()) {
+        std::error_code err;
+        size = std::filesystem::file_size(m_filename, err);
+        if (err) {
+            size = 0;
+        }
+    }
+    else if (m_memory_input.in_memory()) {
+        size = m_memory_input.size();
+    }
+    else if (m_opened_file != nullptr) {
+        struct stat st;
+        if (fstat(fileno(m_opened_file), &st) == 0) {
+            size = st.st_size;
+        }
+    }
+    return size;
+}
+
+void archive::finish_fingerprint() {
+    m_input_size = input_size();
+    m_fingerprint = fnv1a(m_fingerprint, &m_input_size,
+        sizeof(m_input_size));
+}
+
+void archive::begin_progress(progress::stage_type stage,
+    size_t total_entries)
+{
+    m_progress = {};
+    m_progress.stage = stage;
+    m_progress.total_entries = total_entries;
+    m_progress.total_bytes = has_filename() ? input_size() : m_input_size;
+}
+
+void archive::end_progress() {
+    // the rest of the file was skipped
+    report_progress(m_progress.total_bytes);
+}
+
+void archive::report_entry(uint64_t input_bytes) {
+    if (m_progress.stage == progress::stage_type::LISTING) {
+        ++m_progress.entries;
+    }
+    report_progress(input_bytes);
+}
+
+void archive::report_progress(uint64_t input_bytes) {
+    m_progress.bytes = input_bytes;
+    if (m_config.progress_callback) {
+        m_config.progress_callback(m_progress);
+    }
+    m_guard.check_cancelled();
+}
+
+uint64_t archive::fingerprint() const {
+    return m_fingerprint;
+}
+
+bool archive::has_captured(int idx) const {
+    return m_captured.count(idx) == 1;
+}
+
+std::string const& archive::captured(int idx) const {
+    static const std::string no_data = "";
+    if (m_captured.count(idx) == 1) {
+        return m_captured.at(idx);
+    }
+    else {
+        return no_data;
+    }
+}
+
+void archive::clear_captured() {
+    m_captured.clear();
+    m_captured_size = 0;
+}
+
 void archive::add_default_xml_targets(std::string const& shimeji_name) {
     m_default_xml_targets.push_back(shimeji_name);
 }
 
+std::vector<std::string> const& archive::default_xml_targets() const {
+    return m_default_xml_targets;
+}
+
+static const uint32_t k_analysis_magic = 0x31414653; // "SFA1"
+static const uint32_t k_plan_magic = 0x31504653; // "SFP1"
+
+static void write_entry(std::ostream &out, archive_entry const& entry) {
+    write_u64(out, (uint64_t)(int64_t)entry.index());
+    write_string(out, entry.path());
+    auto &targets = entry.extract_targets();
+    write_u32(out, (uint32_t)targets.size());
+    for (auto &target : targets) {
+        write_string(out, target.shimeji_name());
+        write_string(out, target.extract_name());
+        write_u8(out, (uint8_t)target.type());
+    }
+}
+
+static bool read_entry(std::istream &in, name_pool &names, int &index,
+    std::string &path, std::vector<extract_target> &targets)
+{
+    uint64_t raw_index;
+    uint32_t count;
+    if (!read_u64(in, raw_index) || !read_string(in, path) ||
+        !read_u32(in, count))
+    {
+        return false;
+    }
+    index = (int)(int64_t)raw_index;
+    for (uint32_t i=0; i<count; ++i) {
+        std::string shimeji, name;
+        uint8_t type;
+        if (!read_string(in, shimeji) || !read_string(in, name) ||
+            !read_u8(in, type) ||
+            type > (uint8_t)extract_target::extract_type::XML)
+        {
+            return false;
+        }
+        targets.push_back({ names, shimeji, name,
+            (extract_target::extract_type)type });
+    }
+    return true;
+}
+
+template<typename T>
+static void write_names(std::ostream &out, T const& names) {
+    write_u32(out, (uint32_t)names.size());
+    for (auto &name : names) {
+        write_string(out, name);
+    }
+}
+
+template<typename T>
+static bool read_names(std::istream &in, T &names) {
+    uint32_t count;
+    if (!read_u32(in, count)) {
+        return false;
+    }
+    for (uint32_t i=0; i<count; ++i) {
+        std::string name;
+        if (!read_string(in, name)) {
+            return false;
+        }
+        names.insert(names.end(), name);
+    }
+    return true;
+}
+
+void archive::write_analysis(std::ostream &out) const {
+    write_u32(out, k_analysis_magic);
+    write_u64(out, m_entries.size());
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        write_entry(out, *m_entries[i]);
+    }
+    write_names(out, m_default_xml_targets);
+    write_names(out, m_shimejis);
+}
+
+bool archive::read_analysis(std::istream &in) {
+    uint32_t magic;
+    uint64_t entry_count;
+    if (!read_u32(in, magic) || magic != k_analysis_magic ||
+        !read_u64(in, entry_count) || entry_count != m_entries.size())
+    {
+        return false;
+    }
+
+    // read everything before modifying the archive so that a truncated
+    // or mismatching file leaves it untouched
+    std::vector<std::vector<extract_target>> targets(m_entries.size());
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        int index;
+        std::string path;
+        if (!read_entry(in, m_names, index, path, targets[i]) ||
+            index != m_entries[i]->index() || path != m_entries[i]->path())
+        {
+            return false;
+        }
+    }
+    std::vector<std::string> default_xml_targets;
+    std::set<std::string> shimejis;
+    if (!read_names(in, default_xml_targets) || !read_names(in, shimejis)) {
+        return false;
+    }
+
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        m_entries[i]->clear_targets();
+        for (auto &target : targets[i]) {
+            m_entries[i]->add_target(target);
+        }
+    }
+    m_default_xml_targets = default_xml_targets;
+    m_shimejis = shimejis;
+    return true;
+}
+
+void archive::save_plan(std::ostream &out) const {
+    write_u32(out, k_plan_magic);
+    write_string(out, backend_name());
+    write_string(out, m_format_name);
+    write_u64(out, m_fingerprint);
+
+    // entries without targets are never extracted and are left out
+    uint32_t count = 0;
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        if (!m_entries[i]->extract_targets().empty()) {
+            ++count;
+        }
+    }
+    write_u32(out, count);
+    for (size_t i=0; i<m_entries.size(); ++i) {
+        if (!m_entries[i]->extract_targets().empty()) {
+            write_entry(out, *m_entries[i]);
+        }
+    }
+    write_names(out, m_default_xml_targets);
+    write_names(out, m_shimejis);
+}
+
+bool archive::matches_listing(uint64_t fingerprint,
+    std::string const& format)
+{
+    // the archive is only listed for its fingerprint, no entries are
+    // kept. this is cheap when the backend lists it without reading it,
+    // as for zip files with random_access, and a full pass through the
+    // archive otherwise
+    auto config = m_config;
+    m_config.xml_capture_limit = 0;
+    m_config.retain_payloads = false;
+    m_fingerprint_only = true;
+    try {
+        init();
+    }
+    catch (...) {
+        m_config = config;
+        m_fingerprint_only = false;
+        throw;
+    }
+    m_config = config;
+    m_fingerprint_only = false;
+
+    // the rest of the name may be made up by the backend when it lists
+    // an archive without reading it, e.g. "ZIP 2.0 (deflation)"
+    auto family = [](std::string const& name) {
+        return name.substr(0, name.find(' '));
+    };
+    return m_fingerprint == fingerprint &&
+        family(m_format_name) == family(format);
+}
+
+bool archive::load_plan(std::istream &in) {
+    uint32_t magic, count;
+    uint64_t fingerprint;
+    std::string backend, format;
+    if (!read_u32(in, magic) || magic != k_plan_magic ||
+        !read_string(in, backend) || backend != backend_name() ||
+        !read_string(in, format) || !read_u64(in, fingerprint) ||
+        !read_u32(in, count))
+    {
+        return false;
+    }
+    entry_table entries;
+    for (uint32_t i=0; i<count; ++i) {
+        int index;
+        std::string path;
+        std::vector<extract_target> targets;
+        if (!read_entry(in, m_names, index, path, targets)) {
+            return false;
+        }
+        // extract() expects entries in archive order
+        if (entries.size() != 0 &&
+            entries[entries.size() - 1]->index() >= index)
+        {
+            return false;
+        }
+        auto entry = entries.add(index, path);
+        for (auto &target : targets) {
+            entry->add_target(target);
+        }
+    }
+    std::vector<std::string> default_xml_targets;
+    std::set<std::string> shimejis;
+    if (!read_names(in, default_xml_targets) || !read_names(in, shimejis)) {
+        return false;
+    }
+
+    // entries are referred to by index, a plan made for another archive
+    // or for an older version of this one would extract the wrong files
+    if (!matches_listing(fingerprint, format)) {
+        return false;
+    }
+    m_entries = std::move(entries);
+    m_default_xml_targets = default_xml_targets;
+    m_shimejis = shimejis;
+    return true;
+}
+
+bool archive::load_plan(std::istream &in, std::string const& filename) {
+    close();
+    m_filename = filename;
+    m_file_open = nullptr;
+    return load_plan(in);
+}
+
+bool archive::load_plan(std::istream &in, std::function<FILE *()> file_open) {
+    close();
+    m_filename = "";
+    m_file_open = file_open;
+    return load_plan(in);
+}
+
+const char *archive::backend_name() const {
+    return "";
+}
+
+std::string const& archive::format_name() const {
+    return m_format_name;
+}
+
+void archive::set_format_name(std::string const& name) {
+    m_format_name = name;
+}
+
+resource_guard &archive::guard() {
+    return m_guard;
+}
+
+bool archive::convert_to_utf8(std::string &path) {
+    #if SHIMEJIFINDER_HAS_UTF8_CONVERT
+        if (is_valid_utf8(path)) {
+            return true;
+        }
+        SHIMEJIFINDER_TIME_PHASE(m_stats.utf8_convert);
+        SHIMEJIFINDER_COUNT(m_stats.encoding_conversions, 1);
+        return shift_jis_to_utf8(path);
+    #else
+        (void)path;
+        return true;
+    #endif
+}
+
+archive_stats const& archive::stats() const {
+    return m_stats;
+}
+
+extract_plan &archive::plan() {
+    return m_plan;
+}
+
+name_pool &archive::names() {
+    return m_names;
+}
+
+archive_stats &archive::stats() {
+    return m_stats;
+}
+
 void archive::fill_entries() {
     throw std::runtime_error("not implemented");
 }
 
 void archive::revert_to_index(int idx) {
-    m_entries.resize(idx);
+    m_entries.truncate(idx);
 }
 
 void archive::extract() {
@@ -78,22 +522,14 @@ size_t archive::size() const {
     return m_entries.size();
 }
 
-std::shared_ptr<archive_entry> archive::operator[](size_t i) {
+archive_entry *archive::operator[](size_t i) const {
     return m_entries[i];
 }
 
-std::shared_ptr<archive_entry> archive::operator[](size_t i) const {
+archive_entry *archive::at(size_t i) const {
     return m_entries[i];
 }
 
-std::shared_ptr<archive_entry> archive::at(size_t i) {
-    return this->operator[](i);
-}
-
-std::shared_ptr<archive_entry> archive::at(size_t i) const {
-    return this->operator[](i);
-}
-
 bool archive::has_filename() const {
     return !m_filename.empty();
 }
@@ -110,12 +546,15 @@ FILE *archive::open_file() {
     if (has_filename()) {
         file = fopen(m_filename.c_str(), "rb");
     }
-    else {
+    else if (m_file_open != nullptr) {
         file = m_file_open();
     }
     if (file == nullptr) {
         throw std::runtime_error("fopen() failed");
     }
+    if (m_progress.total_bytes == 0) {
+        m_progress.total_bytes = input_size();
+    }
     return file;
 }
 
@@ -126,9 +565,37 @@ void archive::close_opened_file() {
     }
 }
 
+void archive::map_input() {
+    if (!m_config.map_input || m_memory_input.in_memory()) {
+        return;
+    }
+    // the file is opened once, every pass reads from the mapping
+    FILE *file = open_file();
+    m_memory_input.map(fileno(file));
+    close_opened_file();
+}
+
+input_source const& archive::memory_input() const {
+    return m_memory_input;
+}
+
 void archive::init() {
+    m_payloads.reset(m_config.payload_memory_limit,
+        m_config.payload_spill_dir);
+    m_payloads_complete = m_config.retain_payloads;
+    m_nested_archives.clear();
+    m_fingerprint = 0xcbf29ce484222325ULL;
+    m_input_size = 0;
+    m_stats = {};
+    m_guard.reset(m_config);
+    begin_progress(progress::stage_type::LISTING, 0);
     try {
+        SHIMEJIFINDER_TIME_PHASE(m_stats.listing);
+        map_input();
         fill_entries();
+        m_nested_archives.complete();
+        finish_fingerprint();
+        end_progress();
         close_opened_file();
     }
     catch (...) {
@@ -152,11 +619,30 @@ void archive::open(std::function<FILE *()> file_open) {
     init();
 }
 
+void archive::open_memory(std::shared_ptr<const void> owner,
+    const void *data, size_t size)
+{
+    close();
+    m_filename = "";
+    m_file_open = nullptr;
+    m_memory_owner = owner;
+    m_memory_input.open(data, size);
+    init();
+}
+
+void archive::open(const uint8_t *data, size_t size) {
+    open_memory(nullptr, data, size);
+}
+
+void archive::open(std::shared_ptr<const std::vector<uint8_t>> data) {
+    open_memory(data, data->data(), data->size());
+}
+
 void archive::extract_internal_targets(std::string const& filename,
     const char *buf, size_t size)
 {
     for (auto &shimeji : m_default_xml_targets) {
-        begin_write({ shimeji, filename,
+        begin_write({ m_names, shimeji, filename,
             extract_target::extract_type::XML });
     }
     write_next(0, buf, size);
@@ -170,20 +656,68 @@ void archive::extract_internal_targets() {
         default_behaviors_len);
 }
 
+void archive::extract_retained() {
+    for (size_t i=0; i<m_plan.size(); ++i) {
+        auto entry = m_plan[i];
+        m_guard.check_cancelled();
+        for (auto &target : entry->extract_targets()) {
+            begin_write(target);
+        }
+        bool read = m_payloads.read(entry->index(), [this](uint64_t offset,
+            const void *buf, size_t size)
+        {
+            write_next(offset, buf, size);
+        });
+        if (!read) {
+            // the spill file could not be read, the entry would be
+            // truncated
+            throw std::runtime_error("could not read retained contents of " +
+                std::string { entry->path() });
+        }
+        end_write();
+    }
+}
+
 void archive::extract(extractor *extractor) {
     if (m_entries.size() == 0) {
         return;
     }
+    SHIMEJIFINDER_TIME_PHASE(m_stats.extract);
     m_extractor = extractor;
+    m_plan.build(m_entries);
+    size_t total = m_plan.size() + 2; // default actions.xml and behaviors.xml
     try {
-        extract();
+        if (m_config.write_queue_blocks > 0) {
+            m_pipeline = std::make_unique<write_pipeline>(m_extractor,
+                m_stats, m_config.write_queue_blocks);
+        }
+        m_guard.reset(m_config);
+        begin_progress(progress::stage_type::EXTRACTING, total);
+        if (m_payloads_complete) {
+            // every entry was kept while listing, the archive does not
+            // need to be read again
+            extract_retained();
+        }
+        else if (m_plan.size() > 0) {
+            map_input();
+            extract();
+        }
         close_opened_file();
         extract_internal_targets();
+        if (m_pipeline != nullptr) {
+            m_pipeline->finish();
+            m_pipeline = nullptr;
+        }
+        end_progress();
+        m_plan.clear();
         m_extractor->finalize();
         m_extractor = nullptr;
     }
     catch (...) {
+        // stops the writer thread before the extractor is finalized
+        m_pipeline = nullptr;
         close_opened_file();
+        m_plan.clear();
         m_extractor->finalize();
         m_extractor = nullptr;
         throw;
@@ -197,7 +731,14 @@ void archive::extract(std::filesystem::path output) {
 
 void archive::close() {
     m_file_open = nullptr;
+    m_memory_input.close();
+    m_memory_owner = nullptr;
     m_entries.clear();
+    m_names.clear();
+    clear_captured();
+    m_payloads.clear();
+    m_payloads_complete = false;
+    m_nested_archives.clear();
 }
 
 archive::~archive() {
@@ -212,7 +753,17 @@ void archive::add_shimeji(std::string const& shimeji) {
     m_shimejis.insert(shimeji);
 }
 
+analyze_config const& archive::config() const {
+    return m_config;
+}
+
+void archive::set_config(analyze_config const& config) {
+    m_config = config;
+}
+
 archive::archive(): m_file_open(nullptr), m_opened_file(nullptr),
+    m_captured_size(0), m_payloads_complete(false), m_fingerprint(0),
+    m_fingerprint_only(false), m_input_size(0),
     m_extractor(nullptr) {}
 
 }
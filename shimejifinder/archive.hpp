@@ -19,13 +19,26 @@
 // 
 
 #include <vector>
+#include <map>
+#include "analyze_config.hpp"
 #include "archive_entry.hpp"
+#include "entry_table.hpp"
+#include "extract_plan.hpp"
 #include "extract_target.hpp"
+#include "name_pool.hpp"
 #include <functional>
 #include <set>
 #include <memory>
 #include <filesystem>
+#include <istream>
+#include <ostream>
 #include "extractor.hpp"
+#include "input_source.hpp"
+#include "nested_cache.hpp"
+#include "payload_store.hpp"
+#include "resource_guard.hpp"
+#include "stats.hpp"
+#include "write_pipeline.hpp"
 
 namespace shimejifinder {
 
@@ -33,24 +46,67 @@ class archive {
 private:
     std::function<FILE *()> m_file_open;
     FILE *m_opened_file;
+    input_source m_memory_input;
+    std::shared_ptr<const void> m_memory_owner;
     std::string m_filename;
-    std::vector<std::shared_ptr<archive_entry>> m_entries;
+    entry_table m_entries;
+    name_pool m_names;
+    extract_plan m_plan;
     std::set<std::string> m_shimejis;
     std::vector<std::string> m_default_xml_targets;
+    std::map<int, std::string> m_captured;
+    size_t m_captured_size;
+    payload_store m_payloads;
+    bool m_payloads_complete;
+    nested_cache m_nested_archives;
+    uint64_t m_fingerprint;
+    bool m_fingerprint_only;
+    std::string m_format_name;
+    analyze_config m_config;
+    resource_guard m_guard;
+    progress m_progress;
+    archive_stats m_stats;
+    uint64_t m_input_size;
     extractor *m_extractor;
+    std::unique_ptr<write_pipeline> m_pipeline;
     void init();
     void extract_internal_targets(std::string const& filename,
         const char *buf, size_t size);
     void extract_internal_targets();
+    void extract_retained();
+    void finish_fingerprint();
+    uint64_t input_size() const;
+    void begin_progress(progress::stage_type stage, size_t total_entries);
+    void end_progress();
+    bool matches_listing(uint64_t fingerprint, std::string const& format);
+    bool load_plan(std::istream &in);
     void close_opened_file();
+    void map_input();
+    void open_memory(std::shared_ptr<const void> owner, const void *data,
+        size_t size);
 protected:
     void begin_write(extract_target const& entry);
     void write_next(size_t offset, const void *buf, size_t size);
     void end_write();
     void revert_to_index(int idx);
-    void add_entry(archive_entry const& entry);
+    extract_plan &plan();
+    archive_entry *add_entry(int index, std::string const& path);
     void write_target(extract_target const& target, uint8_t *buf, size_t size);
+    size_t capture_limit(archive_entry const& entry) const;
+    void capture(int idx, std::string const& data);
+    bool retains_payloads() const;
+    void begin_retain(int idx, uint64_t size_hint = 0);
+    void retain_next(uint64_t offset, const void *buf, size_t size);
+    void end_retain(bool success);
+    nested_cache &nested_archives();
+    void add_fingerprint(std::string const& path, int64_t size, int64_t mtime);
+    void set_format_name(std::string const& name);
+    resource_guard &guard();
+    bool convert_to_utf8(std::string &path);
+    void report_entry(uint64_t input_bytes);
+    void report_progress(uint64_t input_bytes);
     FILE *open_file();
+    input_source const& memory_input() const;
     bool has_filename() const;
     std::string filename() const;
     virtual void fill_entries();
@@ -58,14 +114,37 @@ protected:
 public:
     archive();
     size_t size() const;
-    std::shared_ptr<archive_entry> operator[](size_t i);
-    std::shared_ptr<archive_entry> operator[](size_t i) const;
-    std::shared_ptr<archive_entry> at(size_t i);
-    std::shared_ptr<archive_entry> at(size_t i) const;
+    archive_entry *operator[](size_t i) const;
+    archive_entry *at(size_t i) const;
     std::set<std::string> const& shimejis();
     void add_shimeji(std::string const& shimeji);
+    analyze_config const& config() const;
+    void set_config(analyze_config const& config);
+    bool has_captured(int idx) const;
+    std::string const& captured(int idx) const;
+    void clear_captured();
+    uint64_t fingerprint() const;
+    std::vector<std::string> const& default_xml_targets() const;
+    void write_analysis(std::ostream &out) const;
+    bool read_analysis(std::istream &in);
+    virtual const char *backend_name() const;
+    std::string const& format_name() const;
+    archive_stats const& stats() const;
+    archive_stats &stats();
+    name_pool &names();
+    void save_plan(std::ostream &out) const;
+    bool load_plan(std::istream &in, std::string const& filename);
+    bool load_plan(std::istream &in, std::function<FILE *()> file_open);
     void open(std::function<FILE *()> file_open);
     void open(std::string const& filename);
+
+    /// Opens an archive that is in memory. The buffer is not copied and
+    /// must stay valid until the archive is closed or destroyed.
+    void open(const uint8_t *data, size_t size);
+
+    /// Opens an archive that is in memory. The archive keeps a reference
+    /// to the buffer until it is closed.
+    void open(std::shared_ptr<const std::vector<uint8_t>> data);
     void extract(extractor *extractor);
     void extract(std::filesystem::path output);
     void close();
@@ -17,35 +17,21 @@
 // 
 
 #include "archive_entry.hpp"
-#include "utils.hpp"
-#include <cstring>
-#include <iostream>
 
 namespace shimejifinder {
 
-archive_entry::archive_entry(): m_valid(false), m_index(-1) {}
-archive_entry::archive_entry(int index): m_valid(false), m_index(index) {}
-archive_entry::archive_entry(int index, std::string const& path): m_valid(true),
-    m_index(index), m_path(path)
-{
-    //XXX: HACK: if path is in the format .../conf/Name/*.xml, convert it to .../img/Name/*.xml
-    size_t slash1, slash2, slash3;
-    slash3 = m_path.rfind('/');
-    if (slash3 == std::string::npos || slash3 == 0) goto skip_check;
-    slash2 = m_path.rfind('/', slash3-1);
-    if (slash2 == std::string::npos || slash2 == 0) goto skip_check;
-    slash1 = m_path.rfind('/', slash2-1);
-    if (slash1 == std::string::npos) slash1 = 0;
-    else slash1 += 1;
-    if (m_path.substr(slash1, slash2-slash1) == "conf" && slash3 - slash2 > 1 &&
-        (m_path.substr(slash3+1) == "actions.xml" || m_path.substr(slash3+1) == "behaviors.xml"))
-    {
-        m_path = m_path.substr(0, slash1) + "img" + m_path.substr(slash2);
-    }
-skip_check:
-    m_lowername = to_lower(last_component(path));
-    m_extension = file_extension(m_lowername);
-}
+archive_entry::archive_entry(): m_index(-1),
+    m_type(extract_target::extract_type::UNSPECIFIED), m_valid(false),
+    m_offset(-1) {}
+
+archive_entry::archive_entry(int index): m_index(index),
+    m_type(extract_target::extract_type::UNSPECIFIED), m_valid(false),
+    m_offset(-1) {}
+
+archive_entry::archive_entry(int index, std::string_view path,
+    std::string_view lower_name): m_index(index),
+    m_type(type_for_name(lower_name)), m_valid(true), m_offset(-1),
+    m_path(path), m_lowername(lower_name) {}
 
 bool archive_entry::valid() const {
     return m_valid;
@@ -55,7 +41,7 @@ void archive_entry::clear_targets() {
     m_extract_targets.clear();
 }
 
-std::string const& archive_entry::path() const {
+std::string_view archive_entry::path() const {
     return m_path;
 }
 
@@ -67,7 +53,7 @@ std::vector<extract_target> const& archive_entry::extract_targets() const {
     return m_extract_targets;
 }
 
-std::string const& archive_entry::lower_name() const {
+std::string_view archive_entry::lower_name() const {
     return m_lowername;
 }
 
@@ -76,15 +62,50 @@ std::string archive_entry::dirname() const {
     if (pos == std::string::npos) {
         return "";
     }
-    return m_path.substr(0, pos);
+    return std::string { m_path.substr(0, pos) };
+}
+
+std::string_view archive_entry::lower_extension() const {
+    auto pos = m_lowername.rfind('.');
+    if (pos == std::string::npos) {
+        return {};
+    }
+    return m_lowername.substr(pos + 1);
 }
 
-std::string const& archive_entry::lower_extension() const {
-    return m_extension;
+extract_target::extract_type archive_entry::type() const {
+    return m_type;
+}
+
+int64_t archive_entry::offset() const {
+    return m_offset;
+}
+
+void archive_entry::set_offset(int64_t offset) {
+    m_offset = offset;
 }
 
 void archive_entry::add_target(extract_target const& target) {
     m_extract_targets.push_back(target);
 }
 
+extract_target::extract_type archive_entry::type_for_name(
+    std::string_view lower_name)
+{
+    auto pos = lower_name.rfind('.');
+    if (pos != std::string::npos) {
+        auto extension = lower_name.substr(pos + 1);
+        if (extension == "png") {
+            return extract_target::extract_type::IMAGE;
+        }
+        if (extension == "wav") {
+            return extract_target::extract_type::SOUND;
+        }
+        if (extension == "xml") {
+            return extract_target::extract_type::XML;
+        }
+    }
+    return extract_target::extract_type::UNSPECIFIED;
+}
+
 }
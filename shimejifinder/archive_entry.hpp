@@ -18,34 +18,54 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 // 
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "extract_target.hpp"
 
 namespace shimejifinder {
 
+/// A file kept while listing an archive. Entries are created by
+/// entry_table, which owns the memory of their paths.
 class archive_entry {
 private:
-    bool m_valid;
     int m_index;
-    std::string m_path;
-    std::string m_lowername;
-    std::string m_dirname;
-    std::string m_extension;
+    extract_target::extract_type m_type;
+    bool m_valid;
+    int64_t m_offset;
+    std::string_view m_path;
+    std::string_view m_lowername;
     std::vector<extract_target> m_extract_targets;
 public:
     archive_entry();
     archive_entry(int index);
-    archive_entry(int index, std::string const& path);
+
+    /// @param path Path of the entry. Not copied, must outlive the entry.
+    /// @param lower_name Last component of path in lowercase. Not copied,
+    ///                   must outlive the entry.
+    archive_entry(int index, std::string_view path,
+        std::string_view lower_name);
     bool valid() const;
     int index() const;
     std::vector<extract_target> const& extract_targets() const;
-    std::string const& path() const;
-    std::string const& lower_name() const;
+    std::string_view path() const;
+    std::string_view lower_name() const;
     std::string dirname() const;
-    std::string const& lower_extension() const;
+    std::string_view lower_extension() const;
+
+    /// IMAGE, SOUND or XML depending on the extension, UNSPECIFIED for
+    /// other files.
+    extract_target::extract_type type() const;
+
+    /// Position of the entry in the archive file if the backend can read
+    /// it without going through the entries before it, -1 otherwise.
+    int64_t offset() const;
+    void set_offset(int64_t offset);
     void add_target(extract_target const& target);
     void clear_targets();
+    static extract_target::extract_type type_for_name(
+        std::string_view lower_name);
 };
 
 }
@@ -20,7 +20,6 @@
 #include "utils.hpp"
 #include <iostream>
 #include <ostream>
-#include <sstream>
 
 static std::ostream &indent(std::ostream &out, int depth) {
     for (int i=0; i<depth; ++i) {
@@ -34,15 +33,18 @@ namespace shimejifinder {
 archive_folder::archive_folder(): m_parent(nullptr) {}
 
 archive_folder *archive_folder::folder_named(std::string const& name) {
-    return m_folders.count(name) == 1 ? &m_folders.at(name) : nullptr;
+    auto iter = m_folders.find(name);
+    return iter != m_folders.end() ? &iter->second : nullptr;
 }
 
 const archive_folder *archive_folder::folder_named(std::string const& name) const {
-    return m_folders.count(name) == 1 ? &m_folders.at(name) : nullptr;
+    auto iter = m_folders.find(name);
+    return iter != m_folders.end() ? &iter->second : nullptr;
 }
 
 archive_entry *archive_folder::entry_named(std::string const& name) const {
-    return m_entries.count(name) == 1 ? m_entries.at(name).get() : nullptr;
+    auto iter = m_entries.find(name);
+    return iter != m_entries.end() ? iter->second : nullptr;
 }
 
 archive_entry *archive_folder::relative_file(
@@ -112,7 +114,7 @@ const std::map<std::string, archive_folder> &archive_folder::folders() const {
     return m_folders;
 }
 
-const std::map<std::string, std::shared_ptr<archive_entry>> &archive_folder::files() const {
+const std::map<std::string, archive_entry *> &archive_folder::files() const {
     return m_entries;
 }
 
@@ -136,7 +138,7 @@ void archive_folder::print(std::ostream &out, int depth) const {
     }
     for (auto &pair : m_entries) {
         auto &entry = pair.second;
-        auto &path = entry->path();
+        auto path = entry->path();
         auto name = path.substr(path.rfind('/') + 1);
         indent(out, depth) << name;
         if (!entry->extract_targets().empty()) {
@@ -163,27 +165,27 @@ archive_folder::archive_folder(archive const& ar, std::string const& root): m_na
         {
             continue;
         }
-        if (path[0] == '/') {
+        if (!path.empty() && path[0] == '/') {
             path = path.substr(1);
         }
-        std::stringstream ss { path };
-        std::string component;
         auto folder = this;
-        while (std::getline(ss, component, '/')) {
-            if (!ss.eof()) {
-                // folder
-                auto subfolder = &folder->m_folders[to_lower(component)];
-                if (subfolder->m_parent == nullptr) {
-                    subfolder->m_parent = folder;
-                    subfolder->m_name = component;
-                }
-                folder = subfolder;
-            }
-            else {
-                // file
-                folder->m_entries[to_lower(component)] = entry;
+        for (size_t start = 0, end = path.find('/');
+            end != std::string::npos;
+            start = end + 1, end = path.find('/', start))
+        {
+            std::string component { path.substr(start, end - start) };
+            auto subfolder = &folder->m_folders[to_lower(component)];
+            if (subfolder->m_parent == nullptr) {
+                subfolder->m_parent = folder;
+                subfolder->m_name = component;
             }
+            folder = subfolder;
+        }
+        if (path.empty() || path.back() == '/') {
+            // not a file
+            continue;
         }
+        folder->m_entries[std::string { entry->lower_name() }] = entry;
     }
 }
 
@@ -33,7 +33,7 @@ private:
     std::string m_name;
     archive_folder *m_parent;
     std::map<std::string, archive_folder> m_folders;
-    std::map<std::string, std::shared_ptr<archive_entry>> m_entries;
+    std::map<std::string, archive_entry *> m_entries;
     void print(std::ostream &out, int depth) const;
 public:
     archive_folder();
@@ -42,7 +42,7 @@ public:
     const archive_folder *parent() const;
     archive_entry *relative_file(std::string const& path) const;
     const std::map<std::string, archive_folder> &folders() const;
-    const std::map<std::string, std::shared_ptr<archive_entry>> &files() const;
+    const std::map<std::string, archive_entry *> &files() const;
     archive_folder *folder_named(std::string const& name);
     const archive_folder *folder_named(std::string const& name) const;
     archive_entry *entry_named(std::string const& name) const;
@@ -0,0 +1,104 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "binary_io.hpp"
+
+namespace shimejifinder {
+
+static void write_le(std::ostream &out, uint64_t value, int bytes) {
+    char buf[8];
+    for (int i=0; i<bytes; ++i) {
+        buf[i] = (char)((value >> (i * 8)) & 0xFF);
+    }
+    out.write(buf, bytes);
+}
+
+static bool read_le(std::istream &in, uint64_t &value, int bytes) {
+    unsigned char buf[8];
+    if (!in.read((char *)buf, bytes)) {
+        return false;
+    }
+    value = 0;
+    for (int i=0; i<bytes; ++i) {
+        value |= (uint64_t)buf[i] << (i * 8);
+    }
+    return true;
+}
+
+void write_u8(std::ostream &out, uint8_t value) {
+    write_le(out, value, 1);
+}
+
+void write_u32(std::ostream &out, uint32_t value) {
+    write_le(out, value, 4);
+}
+
+void write_u64(std::ostream &out, uint64_t value) {
+    write_le(out, value, 8);
+}
+
+void write_string(std::ostream &out, std::string_view value) {
+    write_u32(out, (uint32_t)value.size());
+    out.write(value.data(), value.size());
+}
+
+bool read_u8(std::istream &in, uint8_t &value) {
+    uint64_t tmp;
+    if (!read_le(in, tmp, 1)) {
+        return false;
+    }
+    value = (uint8_t)tmp;
+    return true;
+}
+
+bool read_u32(std::istream &in, uint32_t &value) {
+    uint64_t tmp;
+    if (!read_le(in, tmp, 4)) {
+        return false;
+    }
+    value = (uint32_t)tmp;
+    return true;
+}
+
+bool read_u64(std::istream &in, uint64_t &value) {
+    return read_le(in, value, 8);
+}
+
+bool read_string(std::istream &in, std::string &value) {
+    uint32_t size;
+    if (!read_u32(in, size)) {
+        return false;
+    }
+    // strings are short, refuse sizes that cannot come from a valid file
+    if (size > 64 * 1024 * 1024) {
+        return false;
+    }
+    value.resize(size);
+    return size == 0 || (bool)in.read(&value[0], size);
+}
+
+uint64_t fnv1a(uint64_t hash, const void *buf, size_t size) {
+    auto data = (const unsigned char *)buf;
+    for (size_t i=0; i<size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace shimejifinder {
+
+// little-endian fixed width integers and length-prefixed strings
+
+void write_u8(std::ostream &out, uint8_t value);
+void write_u32(std::ostream &out, uint32_t value);
+void write_u64(std::ostream &out, uint64_t value);
+void write_string(std::ostream &out, std::string_view value);
+bool read_u8(std::istream &in, uint8_t &value);
+bool read_u32(std::istream &in, uint32_t &value);
+bool read_u64(std::istream &in, uint64_t &value);
+bool read_string(std::istream &in, std::string &value);
+
+uint64_t fnv1a(uint64_t hash, const void *buf, size_t size);
+
+}
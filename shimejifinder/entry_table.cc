@@ -0,0 +1,118 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "entry_table.hpp"
+#include "utils.hpp"
+#include <cstring>
+
+namespace shimejifinder {
+
+entry_table::entry_table(): m_chars_left(0), m_size(0) {}
+
+char *entry_table::reserve_chars(size_t size) {
+    if (size > k_block_chars / 4) {
+        // long paths get a buffer of their own so that the rest of the
+        // current block is not wasted
+        std::unique_ptr<char[]> chars { new char[size] };
+        char *ptr = chars.get();
+        m_chars.insert(m_chars.begin(), std::move(chars));
+        return ptr;
+    }
+    if (m_chars.empty() || size > m_chars_left) {
+        m_chars.emplace_back(new char[k_block_chars]);
+        m_chars_left = k_block_chars;
+    }
+    char *chars = m_chars.back().get() + k_block_chars - m_chars_left;
+    m_chars_left -= size;
+    return chars;
+}
+
+archive_entry *entry_table::add(int index, std::string_view path) {
+    //XXX: HACK: if path is in the format .../conf/Name/*.xml, convert it to .../img/Name/*.xml
+    std::string_view prefix, suffix;
+    bool moved = false;
+    size_t slash1, slash2, slash3;
+    slash3 = path.rfind('/');
+    if (slash3 == std::string::npos || slash3 == 0) goto skip_check;
+    slash2 = path.rfind('/', slash3-1);
+    if (slash2 == std::string::npos || slash2 == 0) goto skip_check;
+    slash1 = path.rfind('/', slash2-1);
+    if (slash1 == std::string::npos) slash1 = 0;
+    else slash1 += 1;
+    if (path.substr(slash1, slash2-slash1) == "conf" && slash3 - slash2 > 1 &&
+        (path.substr(slash3+1) == "actions.xml" || path.substr(slash3+1) == "behaviors.xml"))
+    {
+        prefix = path.substr(0, slash1);
+        suffix = path.substr(slash2);
+        moved = true;
+    }
+skip_check:
+    size_t name_start = path.rfind('/') + 1;
+    size_t name_size = path.size() - name_start;
+    size_t path_size = moved ? prefix.size() + 3 + suffix.size() :
+        path.size();
+
+    char *chars = reserve_chars(path_size + name_size);
+    if (moved) {
+        memcpy(chars, prefix.data(), prefix.size());
+        memcpy(chars + prefix.size(), "img", 3);
+        memcpy(chars + prefix.size() + 3, suffix.data(), suffix.size());
+    }
+    else {
+        memcpy(chars, path.data(), path.size());
+    }
+    char *lower_name = chars + path_size;
+    for (size_t i=0; i<name_size; ++i) {
+        lower_name[i] = asciitolower(path[name_start + i]);
+    }
+
+    if (m_size % k_block_entries == 0 &&
+        m_size / k_block_entries == m_blocks.size())
+    {
+        m_blocks.emplace_back(new archive_entry[k_block_entries]);
+    }
+    auto entry = &m_blocks[m_size / k_block_entries][m_size % k_block_entries];
+    *entry = { index, { chars, path_size }, { lower_name, name_size } };
+    ++m_size;
+    return entry;
+}
+
+archive_entry *entry_table::operator[](size_t i) const {
+    return &m_blocks[i / k_block_entries][i % k_block_entries];
+}
+
+size_t entry_table::size() const {
+    return m_size;
+}
+
+void entry_table::truncate(size_t size) {
+    // paths of removed entries stay in the buffer until clear()
+    while (m_size > size) {
+        --m_size;
+        *(*this)[m_size] = {};
+    }
+}
+
+void entry_table::clear() {
+    m_blocks.clear();
+    m_chars.clear();
+    m_chars_left = 0;
+    m_size = 0;
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "archive_entry.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace shimejifinder {
+
+/// Entries of an archive. Entries are stored in fixed-size blocks and
+/// their paths in a shared buffer, so listing allocates once per block
+/// instead of several times per entry, and the table is freed at once.
+/// Pointers to entries stay valid until the table is truncated or cleared.
+class entry_table {
+private:
+    static const size_t k_block_entries = 1024;
+    static const size_t k_block_chars = 64 * 1024;
+    std::vector<std::unique_ptr<archive_entry[]>> m_blocks;
+    std::vector<std::unique_ptr<char[]>> m_chars;
+    size_t m_chars_left;
+    size_t m_size;
+    char *reserve_chars(size_t size);
+public:
+    entry_table();
+    entry_table(entry_table const&) = delete;
+    entry_table &operator=(entry_table const&) = delete;
+    entry_table(entry_table &&) = default;
+    entry_table &operator=(entry_table &&) = default;
+
+    /// Adds an entry. Names of configuration files in .../conf/Name/ are
+    /// moved to .../img/Name/.
+    archive_entry *add(int index, std::string_view path);
+    archive_entry *operator[](size_t i) const;
+    size_t size() const;
+    void truncate(size_t size);
+    void clear();
+};
+
+}
@@ -0,0 +1,63 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "extract_plan.hpp"
+
+namespace shimejifinder {
+
+extract_plan::extract_plan(): m_next(0) {}
+
+void extract_plan::build(entry_table const& entries) {
+    m_needed.clear();
+    m_next = 0;
+    for (size_t i=0; i<entries.size(); ++i) {
+        auto entry = entries[i];
+        if (entry->valid() && !entry->extract_targets().empty()) {
+            m_needed.push_back(entry);
+        }
+    }
+}
+
+void extract_plan::clear() {
+    m_needed.clear();
+    m_next = 0;
+}
+
+archive_entry *extract_plan::take(int index) {
+    while (m_next < m_needed.size() && m_needed[m_next]->index() < index) {
+        ++m_next;
+    }
+    if (m_next < m_needed.size() && m_needed[m_next]->index() == index) {
+        return m_needed[m_next++];
+    }
+    return nullptr;
+}
+
+bool extract_plan::done() const {
+    return m_next >= m_needed.size();
+}
+
+size_t extract_plan::size() const {
+    return m_needed.size();
+}
+
+archive_entry *extract_plan::operator[](size_t i) const {
+    return m_needed[i];
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "archive_entry.hpp"
+#include "entry_table.hpp"
+#include <vector>
+
+namespace shimejifinder {
+
+/// Entries that have to be written during an extraction, in archive
+/// order. Backends look up every entry they come across with take() and
+/// can stop reading the archive once done() returns true.
+class extract_plan {
+private:
+    std::vector<archive_entry *> m_needed;
+    size_t m_next;
+public:
+    extract_plan();
+    void build(entry_table const& entries);
+    void clear();
+
+    /// Returns the entry with the given index if it has to be written,
+    /// nullptr otherwise. Indices must be passed in increasing order.
+    archive_entry *take(int index);
+
+    /// True once every needed entry was taken or passed.
+    bool done() const;
+    size_t size() const;
+    archive_entry *operator[](size_t i) const;
+};
+
+}
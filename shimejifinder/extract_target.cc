@@ -21,29 +21,27 @@
 namespace shimejifinder {
 
 std::string const& extract_target::shimeji_name() const {
-    return m_shimeji_name;
+    return *m_shimeji_name;
 }
 
 std::string const& extract_target::extract_name() const {
-    return m_extract_name;
+    return *m_extract_name;
 }
 
 extract_target::extract_type extract_target::type() const {
     return m_type;
 }
 
-void extract_target::set_extract_name(std::string const& name) {
-    m_extract_name = name;
-}
-
-extract_target::extract_target():
-    m_type(extract_type::UNSPECIFIED) {}
+extract_target::extract_target(): m_shimeji_name(name_pool::empty()),
+    m_extract_name(name_pool::empty()), m_type(extract_type::UNSPECIFIED) {}
 
-extract_target::extract_target(std::string const& filename):
-    m_extract_name(filename), m_type(extract_type::UNSPECIFIED) {}
+extract_target::extract_target(const std::string *shimeji_name,
+    const std::string *filename, extract_type type):
+    m_shimeji_name(shimeji_name), m_extract_name(filename), m_type(type) {}
 
-extract_target::extract_target(std::string const& shimeji_name, std::string const& filename,
-    extract_type type): m_shimeji_name(shimeji_name), m_extract_name(filename),
-    m_type(type) {}
+extract_target::extract_target(name_pool &names, std::string_view shimeji_name,
+    std::string_view filename, extract_type type):
+    m_shimeji_name(names.intern(shimeji_name)),
+    m_extract_name(names.intern(filename)), m_type(type) {}
 
 }
@@ -19,9 +19,14 @@
 // 
 
 #include <string>
+#include <string_view>
+#include "name_pool.hpp"
 
 namespace shimejifinder {
 
+/// A file to write an archive entry to. Names are interned in the
+/// archive's name pool, so targets are small and cheap to copy, and only
+/// valid while the archive that created them is open.
 class extract_target {
 public:
     enum class extract_type {
@@ -31,18 +36,18 @@ public:
         XML
     };
 private:
-    std::string m_shimeji_name;
-    std::string m_extract_name;
+    const std::string *m_shimeji_name;
+    const std::string *m_extract_name;
     extract_type m_type;
 public:
     std::string const& shimeji_name() const;
     std::string const& extract_name() const;
     extract_type type() const;
-    void set_extract_name(std::string const& name);
     extract_target();
-    extract_target(std::string const& filename);
-    extract_target(std::string const& shimeji_name, std::string const& filename,
-        extract_type type);
+    extract_target(const std::string *shimeji_name,
+        const std::string *filename, extract_type type);
+    extract_target(name_pool &names, std::string_view shimeji_name,
+        std::string_view filename, extract_type type);
 };
 
 }
@@ -0,0 +1,119 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include "input_source.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shimejifinder {
+
+input_source::input_source(): m_fd(-1), m_data(nullptr), m_size(0),
+    m_mapped(false) {}
+
+input_source::input_source(int fd): input_source() {
+    open(fd);
+}
+
+input_source::~input_source() {
+    close();
+}
+
+void input_source::open(int fd) {
+    close();
+    m_fd = fd;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        m_size = (uint64_t)st.st_size;
+    }
+}
+
+bool input_source::map(int fd) {
+    close();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (uint64_t)st.st_size > SIZE_MAX)
+    {
+        return false;
+    }
+    void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+        fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    // archives are mostly read from start to end
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    m_data = (const uint8_t *)data;
+    m_size = (uint64_t)st.st_size;
+    m_mapped = true;
+    return true;
+}
+
+void input_source::open(const void *data, size_t size) {
+    static const uint8_t empty = 0;
+    close();
+    m_data = data != nullptr ? (const uint8_t *)data : &empty;
+    m_size = data != nullptr ? size : 0;
+}
+
+void input_source::close() {
+    if (m_mapped) {
+        munmap((void *)m_data, (size_t)m_size);
+    }
+    m_fd = -1;
+    m_mapped = false;
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool input_source::is_open() const {
+    return m_data != nullptr || m_fd >= 0;
+}
+
+bool input_source::in_memory() const {
+    return m_data != nullptr;
+}
+
+const uint8_t *input_source::data() const {
+    return m_data;
+}
+
+uint64_t input_source::size() const {
+    return m_size;
+}
+
+ssize_t input_source::read(uint64_t offset, void *buf, size_t size) const {
+    if (m_data == nullptr) {
+        if (m_fd < 0) {
+            return -1;
+        }
+        return pread(m_fd, buf, size, (off_t)offset);
+    }
+    if (offset >= m_size) {
+        return 0;
+    }
+    size = (size_t)std::min((uint64_t)size, m_size - offset);
+    memcpy(buf, m_data + offset, size);
+    return (ssize_t)size;
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace shimejifinder {
+
+/// Random access to an archive, either in memory or read from a file with
+/// pread(). Neither has a file position, so a source can be read from
+/// several threads at once.
+class input_source {
+private:
+    int m_fd;
+    const uint8_t *m_data;
+    uint64_t m_size;
+    bool m_mapped;
+public:
+    input_source();
+
+    explicit input_source(int fd);
+    input_source(input_source const&) = delete;
+    input_source &operator=(input_source const&) = delete;
+    ~input_source();
+
+    /// Reads the file open at fd with pread(). fd is not closed by the
+    /// source and must stay open while it is used.
+    void open(int fd);
+
+    /// Maps the regular file open at fd into memory. fd may be closed
+    /// afterwards. Returns false if the file cannot be mapped, leaving the
+    /// source closed. The file must not be truncated while it is mapped.
+    bool map(int fd);
+
+    /// Reads from a buffer owned by the caller, which must stay valid
+    /// while the source is used.
+    void open(const void *data, size_t size);
+
+    void close();
+    bool is_open() const;
+    bool in_memory() const;
+
+    /// The contents of a mapped file or buffer, nullptr if the source
+    /// reads from a file.
+    const uint8_t *data() const;
+    uint64_t size() const;
+
+    /// Reads up to size bytes at offset. Returns the number of bytes read,
+    /// 0 at the end of the file or -1 on error.
+    ssize_t read(uint64_t offset, void *buf, size_t size) const;
+};
+
+}
@@ -27,14 +27,19 @@
 #include <string>
 #include <stdlib.h>
 #include "../utils.hpp"
+#include "../zip_directory.hpp"
+#include "../utf8_convert.hpp"
 #include <cstdio>
-#include <sstream>
 #include <archive.h>
 #include <archive_entry.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <langinfo.h>
+#include <algorithm>
 #include <iostream>
 #include <functional>
-#include "../utf8_convert.hpp"
+#include <mutex>
+#include <vector>
 
 #if SHIMEJIFINDER_DYNAMIC_LIBARCHIVE
 #include <dlfcn.h>
@@ -48,20 +53,26 @@ namespace libarchive {
 ::archive *(*archive::archive_read_new)() = NULL;
 int (*archive::archive_read_support_filter_all)(::archive *) = NULL;
 int (*archive::archive_read_support_format_all)(::archive *) = NULL;
+int (*archive::archive_read_support_format_zip_streamable)(::archive *) = NULL;
 int (*archive::archive_read_free)(::archive *) = NULL;
 const char *(*archive::archive_error_string)(::archive *) = NULL;
 int (*archive::archive_read_next_header)(::archive *, ::archive_entry **) = NULL;
 mode_t (*archive::archive_entry_filetype)(::archive_entry *) = NULL;
 int (*archive::archive_read_data_skip)(::archive *) = NULL;
 const char *(*archive::archive_entry_pathname)(::archive_entry *) = NULL;
+la_int64_t (*archive::archive_entry_size)(::archive_entry *) = NULL;
+time_t (*archive::archive_entry_mtime)(::archive_entry *) = NULL;
 int (*archive::archive_read_open2)(::archive *a, void *, archive_open_callback *,
     archive_read_callback *, archive_skip_callback *, archive_close_callback *) = NULL;
 int (*archive::archive_read_open_fd)(::archive *, int, size_t) = NULL;
 int (*archive::archive_read_data_block)(::archive *, const void **, size_t *,
     la_int64_t *) = NULL;
 la_int64_t (*archive::archive_seek_data)(::archive *, la_int64_t, int) = NULL;
-int (*archive::archive_read_open_memory)(::archive *, const void *, size_t) = NULL;
+int (*archive::archive_read_open_memory2)(::archive *, const void *, size_t,
+    size_t) = NULL;
 int (*archive::archive_read_open_filename)(::archive *, const char *, size_t) = NULL;
+const char *(*archive::archive_format_name)(::archive *) = NULL;
+la_int64_t (*archive::archive_filter_bytes)(::archive *, int) = NULL;
 
 bool archive::loaded = false;
 
@@ -83,18 +94,23 @@ const char *archive::load(const char *path) {
     load(archive_read_new);
     load(archive_read_support_filter_all);
     load(archive_read_support_format_all);
+    load(archive_read_support_format_zip_streamable);
     load(archive_read_free);
     load(archive_error_string);
     load(archive_read_next_header);
     load(archive_entry_filetype);
     load(archive_read_data_skip);
     load(archive_entry_pathname);
+    load(archive_entry_size);
+    load(archive_entry_mtime);
     load(archive_read_open2);
     load(archive_read_open_fd);
     load(archive_read_data_block);
     load(archive_seek_data);
-    load(archive_read_open_memory);
+    load(archive_read_open_memory2);
     load(archive_read_open_filename);
+    load(archive_format_name);
+    load(archive_filter_bytes);
 
     #undef load
 
@@ -118,25 +134,62 @@ static void fix_japanese(std::string &path) {
     }
 }
 
+// largest block handed to libarchive from memory. the compression ratio
+// check only sees input once it is consumed, so whole-file blocks would
+// make stored entries look like they have no input at all
+static const size_t k_memory_block_size = 1024 * 1024;
+
+int archive::archive_open(::archive *ar, input_source const& memory) {
+    // blocks are handed to libarchive without being copied
+    return archive_read_open_memory2(ar, memory.data(),
+        (size_t)memory.size(), k_memory_block_size);
+}
+
 int archive::archive_open(::archive *ar) {
-    if (has_filename()) {
+    if (memory_input().in_memory()) {
+        return archive_open(ar, memory_input());
+    }
+    else if (has_filename()) {
         auto name = filename();
         return archive_read_open_filename(ar, name.c_str(), 102400);
     }
     else {
         // archive_read_open_FILE does not implement seek callback
-        return archive_read_open_fd(ar, fileno(open_file()), 102400);
+        return archive_read_open_fd(ar, fileno(input_file()), 102400);
+    }
+}
+
+FILE *archive::input_file() {
+    if (m_file == nullptr) {
+        m_file = open_file();
+    }
+    return m_file;
+}
+
+input_source const& archive::input() {
+    if (memory_input().in_memory()) {
+        return memory_input();
+    }
+    if (!m_file_input.is_open()) {
+        m_file_input.open(fileno(input_file()));
     }
+    return m_file_input;
 }
 
-void archive::iterate_archive(std::function<void (int, ::archive *, std::string const&)> cb) {
+void archive::iterate_archive(std::function<bool (int, ::archive *,
+    ::archive_entry *, std::string const&)> cb)
+{
     int idx = 0;
 
-    ::archive *ar = archive_read_new();
-    archive_read_support_filter_all(ar);
-    archive_read_support_format_all(ar);
-    
-    int ret = archive_open(ar);
+    ::archive *ar;
+    int ret;
+    {
+        SHIMEJIFINDER_TIME_PHASE(stats().open);
+        ar = archive_read_new();
+        archive_read_support_filter_all(ar);
+        archive_read_support_format_all(ar);
+        ret = archive_open(ar);
+    }
 
     if (ret != ARCHIVE_OK) {
         auto err = get_error(ar);
@@ -144,31 +197,68 @@ void archive::iterate_archive(std::function<void (int, ::archive *, std::string
         throw std::runtime_error("archive_open() failed: " + err);
     }
 
-    iterate_archive(ar, idx, "", cb);
+    // nested archives are read from this archive, its position is the
+    // progress through the archive file
+    m_input = ar;
+    m_input_offset = 0;
+    m_stopped = false;
+    try {
+        iterate_archive(ar, idx, "", cb);
+    }
+    catch (...) {
+        m_input = nullptr;
+        throw;
+    }
+    m_input = nullptr;
+}
+
+uint64_t archive::input_position() {
+    if (m_input == nullptr) {
+        return 0;
+    }
+    la_int64_t position = archive_filter_bytes(m_input, -1);
+    return m_input_offset + (position > 0 ? (uint64_t)position : 0);
 }
 
 bool archive::read_data(::archive *ar, std::function<bool (long, const void *, size_t)> cb) {
+    la_int64_t start = archive_filter_bytes(ar, -1);
     while (true) {
         const void *buf;
         size_t size;
         la_int64_t offset;
 
-        int ret = archive_read_data_block(ar, &buf, &size, &offset);
+        int ret;
+        {
+            SHIMEJIFINDER_TIME_BLOCKS(stats().decompression);
+            ret = archive_read_data_block(ar, &buf, &size, &offset);
+        }
         if (ret == ARCHIVE_EOF) {
             return true;
         }
         else if (ret != ARCHIVE_OK) {
+            guard().rethrow_pending();
             std::cerr << "archive_read_data_block() failed: " << get_error(ar) << std::endl;
             return false;
         }
 
+        SHIMEJIFINDER_COUNT(stats().bytes_decompressed, size);
+        guard().add_bytes(size);
+        guard().check_ratio((uint64_t)offset + size,
+            archive_filter_bytes(ar, -1) - start);
+        report_progress(input_position());
         if (!cb((long)offset, buf, size)) {
             return false;
         }
     }
 }
 
-archive::nested_context::nested_context(::archive *parent): parent(parent), offset(0) {
+archive::nested_context::nested_context(::archive *parent, resource_guard &guard,
+    archive_stats &stats, int copy_fd, uint64_t copy_limit): parent(parent),
+    offset(0), pending(nullptr), pending_offset(0), pending_size(0),
+    guard(guard), stats(stats), parent_start(archive_filter_bytes(parent, -1)),
+    copy_fd(copy_fd), copy_limit(copy_limit), copy_size(0), eof(false),
+    aborted(false)
+{
     // deallocated in iterate_archive()
     ar = archive_read_new();
     archive_read_support_filter_all(ar);
@@ -179,6 +269,7 @@ archive::nested_context::nested_context(::archive *parent): parent(parent), offs
     if (ret != ARCHIVE_OK) {
         auto err = get_error(ar);
         archive_read_free(ar);
+        guard.rethrow_pending();
         throw std::runtime_error("archive_read_open2() failed: " + err);
     }
 }
@@ -187,44 +278,239 @@ archive::nested_context::nested_context(::archive *parent): parent(parent), offs
     return ar;
 }
 
-bool archive::nested_context::read(la_int64_t *size, const void **out_buf) {
+// returned for sparse gaps in the parent entry
+static const uint8_t k_zeros[64 * 1024] = {};
+
+bool archive::nested_context::next_block() {
     const void *parent_buf;
-    la_int64_t parent_offset;
     size_t parent_size;
+    la_int64_t parent_offset;
     int ret = archive_read_data_block(parent, &parent_buf, &parent_size, &parent_offset);
-    if (parent_offset < offset) {
+    if (ret == ARCHIVE_EOF) {
+        eof = true;
+        return true;
+    }
+    if (ret != ARCHIVE_OK || parent_offset < 0 || (uint64_t)parent_offset < offset) {
         // offset cannot decrease, impossible condition
         archive_read_data_skip(parent);
+        eof = true;
         return false;
     }
-    if (ret == ARCHIVE_EOF) {
-        *out_buf = &buf[0];
+    SHIMEJIFINDER_COUNT(stats.bytes_decompressed, parent_size);
+    try {
+        guard.add_bytes(parent_size);
+        guard.check_ratio((uint64_t)parent_offset + parent_size,
+            archive_filter_bytes(parent, -1) - parent_start);
+    }
+    catch (read_aborted &) {
+        // exceptions must not pass through libarchive, the error is
+        // reported once control returns to iterate_archive()
+        guard.set_pending();
+        aborted = true;
+        eof = true;
+        return false;
+    }
+    if (copy_fd != -1) {
+        uint64_t end = (uint64_t)parent_offset + parent_size;
+        if (end > copy_limit || !write_spill_file(copy_fd,
+            (uint64_t)parent_offset, parent_buf, parent_size))
+        {
+            // reading continues without the copy
+            copy_fd = -1;
+        }
+        else if (end > copy_size) {
+            copy_size = end;
+        }
+    }
+    pending = (const uint8_t *)parent_buf;
+    pending_offset = (uint64_t)parent_offset;
+    pending_size = parent_size;
+    return true;
+}
+
+bool archive::nested_context::finish_copy(uint64_t &size) {
+    // nested readers stop before the end of their input, for example at
+    // the central directory of a zip file
+    while (copy_fd != -1 && !eof) {
+        pending_size = 0;
+        if (!next_block()) {
+            return false;
+        }
+    }
+    size = copy_size;
+    return copy_fd != -1;
+}
+
+bool archive::nested_context::read(la_int64_t *size, const void **out_buf) {
+    if (pending_size == 0 && (eof || !next_block())) {
+        *out_buf = k_zeros;
+        *size = 0;
+        return !aborted;
+    }
+    if (pending_size == 0) {
+        // parent entry ended
+        *out_buf = k_zeros;
         *size = 0;
         return true;
     }
-    else if (ret != ARCHIVE_OK) {
-        archive_read_data_skip(parent);
-        return false;
+    if (offset < pending_offset) {
+        size_t gap = (size_t)std::min((uint64_t)sizeof(k_zeros),
+            pending_offset - offset);
+        offset += gap;
+        *out_buf = k_zeros;
+        *size = (la_int64_t)gap;
+        return true;
+    }
+
+    // the parent's block stays valid until the parent is read again,
+    // which only happens on the next call
+    offset += pending_size;
+    *out_buf = pending;
+    *size = (la_int64_t)pending_size;
+    pending_size = 0;
+    return true;
+}
+
+la_int64_t archive::nested_context::skip(la_int64_t request) {
+    // skipped data is read from the parent, which cannot seek inside an
+    // entry, but it is not passed to the nested reader
+    la_int64_t skipped = 0;
+    while (skipped < request) {
+        if (pending_size == 0 && (eof || !next_block() || pending_size == 0)) {
+            break;
+        }
+        uint64_t step = std::min(pending_offset + pending_size - offset,
+            (uint64_t)(request - skipped));
+        offset += step;
+        skipped += (la_int64_t)step;
+        if (offset > pending_offset) {
+            size_t consumed = (size_t)(offset - pending_offset);
+            pending += consumed;
+            pending_size -= consumed;
+            pending_offset = offset;
+        }
     }
-    size_t new_buf_size = parent_offset - offset + parent_size;
-    if (buf.size() < new_buf_size) {
-        buf.resize(new_buf_size);
+    return skipped;
+}
+
+archive::direct_context::direct_context(input_source const& source,
+    uint64_t offset): source(source), position(offset)
+{
+    // the entry is read in streaming mode, which only needs its local
+    // file header
+    ar = archive_read_new();
+    archive_read_support_format_zip_streamable(ar);
+    int ret = archive_read_open2(ar, this, nullptr, &read_callback,
+        &skip_callback, nullptr);
+    if (ret != ARCHIVE_OK) {
+        auto err = get_error(ar);
+        archive_read_free(ar);
+        throw std::runtime_error("archive_read_open2() failed: " + err);
     }
-    memset(&buf[0], 0, parent_offset - offset);
-    memcpy(&buf[parent_offset - offset], parent_buf, parent_size);
-    offset = parent_offset + parent_size;
+}
+
+archive::direct_context::~direct_context() {
+    archive_read_free(ar);
+}
+
+::archive *archive::direct_context::archive() {
+    return ar;
+}
+
+// reads the next block of source for a streaming reader
+static la_ssize_t read_source(input_source const& source, uint64_t &position,
+    std::vector<uint8_t> &buf, const void **out_buf)
+{
+    if (source.in_memory()) {
+        // blocks point into memory, without copying them
+        if (position >= source.size()) {
+            return 0;
+        }
+        *out_buf = source.data() + position;
+        la_ssize_t size = (la_ssize_t)std::min((uint64_t)k_memory_block_size,
+            source.size() - position);
+        position += size;
+        return size;
+    }
+    if (buf.empty()) {
+        buf.resize(64 * 1024);
+    }
+    ssize_t ret = source.read(position, &buf[0], buf.size());
+    if (ret < 0) {
+        return -1;
+    }
+    position += ret;
     *out_buf = &buf[0];
-    *size = (la_int64_t)parent_size;
-    return true;
+    return (la_ssize_t)ret;
+}
+
+la_ssize_t archive::direct_context::read_callback(::archive *sender, void *data,
+    const void **buf)
+{
+    (void)sender;
+    auto ctx = (archive::direct_context *)data;
+    return read_source(ctx->source, ctx->position, ctx->buf, buf);
+}
+
+la_int64_t archive::direct_context::skip_callback(::archive *sender, void *data,
+    la_int64_t skip)
+{
+    (void)sender;
+    auto ctx = (archive::direct_context *)data;
+    ctx->position += skip;
+    return skip;
+}
+
+archive::cached_context::cached_context(int fd): position(0) {
+    if (!source.map(fd)) {
+        source.open(fd);
+    }
+
+    // read in streaming mode like the first time, so that the same
+    // entries are found in the same order
+    ar = archive_read_new();
+    archive_read_support_filter_all(ar);
+    archive_read_support_format_all(ar);
+    int ret = archive_read_open2(ar, this, nullptr, &read_callback,
+        &skip_callback, nullptr);
+    if (ret != ARCHIVE_OK) {
+        auto err = get_error(ar);
+        archive_read_free(ar);
+        throw std::runtime_error("archive_read_open2() failed: " + err);
+    }
+}
+
+::archive *archive::cached_context::archive() {
+    // deallocated in iterate_archive()
+    return ar;
+}
+
+la_ssize_t archive::cached_context::read_callback(::archive *sender, void *data,
+    const void **buf)
+{
+    (void)sender;
+    auto ctx = (archive::cached_context *)data;
+    return read_source(ctx->source, ctx->position, ctx->buf, buf);
+}
+
+la_int64_t archive::cached_context::skip_callback(::archive *sender, void *data,
+    la_int64_t skip)
+{
+    (void)sender;
+    auto ctx = (archive::cached_context *)data;
+    ctx->position += skip;
+    return skip;
 }
 
-bool archive::read_data(::archive *ar, std::ostream &out, size_t max_size) {
+bool archive::read_data(::archive *ar, std::string &out, size_t max_size) {
     return read_data(ar, [&out, max_size](long offset, const void *buf, size_t size){
         if ((offset + size) > max_size) {
             return false;
         }
-        out.seekp(offset);
-        out.write((const char *)buf, size);
+        if (out.size() < offset + size) {
+            out.resize(offset + size);
+        }
+        memcpy(&out[offset], buf, size);
         return true;
     });
 }
@@ -241,15 +527,16 @@ la_ssize_t archive::nested_context::read_callback(::archive *sender, void *data,
     (void)sender;
     auto ctx = (archive::nested_context *)data;
     la_int64_t size;
-    bool success = ctx->read(&size, buf);
-    return success ? (la_ssize_t)size : 0;
+    if (!ctx->read(&size, buf)) {
+        return ctx->aborted ? -1 : 0;
+    }
+    return (la_ssize_t)size;
 }
 
 la_int64_t archive::nested_context::skip_callback(::archive *sender, void *data, la_int64_t skip) {
     (void)sender;
-    (void)data;
-    (void)skip;
-    return 0;
+    auto ctx = (archive::nested_context *)data;
+    return ctx->skip(skip);
 }
 
 int archive::nested_context::close_callback(::archive *sender, void *data) {
@@ -259,11 +546,18 @@ int archive::nested_context::close_callback(::archive *sender, void *data) {
 }
 
 bool archive::try_recurse(int &idx, ::archive *parent, ::archive_entry *entry, std::string const& pathname,
-    std::function<void (int, ::archive *, std::string const&)> &cb)
+    std::function<bool (int, ::archive *, ::archive_entry *, std::string const&)> &cb)
 {
     auto ext = to_lower(file_extension(pathname));
     (void)entry;
     size_t size_without_ext = pathname.size() - ext.size() - 1;
+
+    // nested archives read while listing are kept in the cache. later
+    // passes go through the same entries in the same order and find them
+    // again at the same index
+    uint64_t cache_limit = retains_payloads() ? 0 : config().nested_cache_limit;
+    uint64_t cached_size = 0;
+    int cached_fd = nested_archives().find(idx, pathname, cached_size);
     if (ext == "zip") {
         auto filename = to_lower(last_component(pathname));
         if (filename == "src.zip") {
@@ -271,45 +565,154 @@ bool archive::try_recurse(int &idx, ::archive *parent, ::archive_entry *entry, s
             return false;
         }
         auto new_root = pathname.substr(0, size_without_ext) + "/";
+        guard().enter_nested();
+        int first_idx = idx;
+        int fd = -1;
         try {
-            // try extracting nested archive without extracting whole archive into memory
-            nested_context ctx { parent };
+            if (cached_fd != -1) {
+                cached_context ctx { cached_fd };
+                SHIMEJIFINDER_COUNT(stats().nested_archives, 1);
+                iterate_archive(ctx.archive(), idx, new_root, cb);
+                guard().leave_nested();
+                return true;
+            }
+
+            // try extracting nested archive without extracting whole archive
+            // into memory. if it fits in the cache, a copy is kept for the
+            // next pass
+            uint64_t copy_limit = 0;
+            if (cache_limit != 0) {
+                nested_archives().add(first_idx, pathname);
+                copy_limit = cache_limit - std::min(cache_limit,
+                    nested_archives().size());
+            }
+            bool in_memory = false;
+            if (copy_limit != 0) {
+                fd = create_spill_file(config().payload_spill_dir,
+                    &in_memory);
+            }
+            if (in_memory) {
+                // memory files are not moved to disk while the copy is
+                // made, larger archives are not cached
+                copy_limit = std::min(copy_limit,
+                    config().spill_memory_limit);
+            }
+            nested_context ctx { parent, guard(), stats(), fd, copy_limit };
             auto ar = ctx.archive();
+            SHIMEJIFINDER_COUNT(stats().nested_archives, 1);
             iterate_archive(ar, idx, new_root, cb);
+            uint64_t size;
+            if (fd != -1 && !m_stopped) {
+                if (!ctx.finish_copy(size)) {
+                    guard().rethrow_pending();
+                }
+                else if (nested_archives().insert(first_idx, pathname, fd,
+                    size, cache_limit))
+                {
+                    fd = -1;
+                }
+            }
+            if (fd != -1) {
+                ::close(fd);
+            }
+            guard().leave_nested();
             return true;
         }
+        catch (read_aborted &) {
+            if (fd != -1) {
+                ::close(fd);
+            }
+            throw;
+        }
         catch (std::exception &ex) {
+            if (fd != -1) {
+                ::close(fd);
+            }
+            guard().leave_nested();
             std::cerr << "failed to extract nested archive: " << ex.what() << std::endl;
         }
     }
     else if (ext == "7z" || ext == "rar") {
         auto new_root = pathname.substr(0, size_without_ext) + "/";
+        guard().enter_nested();
+        int first_idx = idx;
+        if (cache_limit != 0) {
+            nested_archives().add(first_idx, pathname);
+        }
+
+        // 7z and rar readers need to seek, the nested archive is written
+        // to a spill file and read from there like an archive file. this
+        // keeps it out of the heap, whatever its size, and large archives
+        // out of memory files
+        int fd = cached_fd;
         try {
-            // try extracting nested archive into memory first
-            std::ostringstream ss;
-            bool read = read_data(parent, ss, 50 * 1024 * 1024);
+            uint64_t size = cached_size;
+            bool read = cached_fd != -1;
+            if (!read) {
+                auto &spill_dir = config().payload_spill_dir;
+                bool in_memory;
+                fd = create_spill_file(spill_dir, &in_memory);
+                if (fd == -1) {
+                    throw std::runtime_error("could not create spill file");
+                }
+                uint64_t memory_limit = config().spill_memory_limit;
+                read = read_data(parent, [&fd, &size, &in_memory,
+                    &spill_dir, memory_limit](long offset, const void *buf,
+                    size_t buf_size)
+                {
+                    if (in_memory && (uint64_t)offset + buf_size >
+                        memory_limit)
+                    {
+                        // too large to stay in memory
+                        if (!move_spill_file(fd, size, spill_dir)) {
+                            return false;
+                        }
+                        in_memory = false;
+                    }
+                    size = std::max(size, (uint64_t)offset + buf_size);
+                    return write_spill_file(fd, offset, buf, buf_size);
+                });
+            }
+            else if (lseek(fd, 0, SEEK_SET) != 0) {
+                throw std::runtime_error("could not rewind cached archive");
+            }
             if (read) {
-                auto str = ss.str();
-                ss.str("");
                 auto ar = archive_read_new();
                 archive_read_support_filter_all(ar);
                 archive_read_support_format_all(ar);
-                int ret = archive_read_open_memory(ar, &str[0], str.size());
+                int ret = archive_read_open_fd(ar, fd, 102400);
                 if (ret != ARCHIVE_OK) {
                     auto err = get_error(ar);
                     archive_read_free(ar);
-                    throw std::runtime_error("archive_read_open_memory() failed: " + err);
+                    throw std::runtime_error("archive_read_open_fd() failed: " + err);
                 }
+                SHIMEJIFINDER_COUNT(stats().nested_archives, 1);
                 iterate_archive(ar, idx, new_root, cb);
+                if (fd != cached_fd && !nested_archives().insert(first_idx,
+                    pathname, fd, size, cache_limit))
+                {
+                    ::close(fd);
+                }
+                guard().leave_nested();
                 return true;
             }
             else {
-                std::cerr << "cannot read nested archive into buffer" << std::endl;
+                std::cerr << "cannot read nested archive" << std::endl;
             }
         }
+        catch (read_aborted &) {
+            if (fd != -1 && fd != cached_fd) {
+                ::close(fd);
+            }
+            throw;
+        }
         catch (std::exception &ex) {
             std::cerr << "failed to extract nested archive: " << ex.what() << std::endl;
         }
+        if (fd != -1 && fd != cached_fd) {
+            ::close(fd);
+        }
+        guard().leave_nested();
     }
     return false;
 }
@@ -320,8 +723,13 @@ std::string archive::get_error(::archive *ar) {
     return std::string { err };
 }
 
+bool archive::is_zip(::archive *ar) {
+    const char *format = archive_format_name(ar);
+    return format != nullptr && strncmp(format, "ZIP", 3) == 0;
+}
+
 void archive::iterate_archive(::archive *ar, int &idx, std::string const& root,
-    std::function<void (int, ::archive *, std::string const&)> &cb)
+    std::function<bool (int, ::archive *, ::archive_entry *, std::string const&)> &cb)
 {
     #if SHIMEJIFINDER_DYNAMIC_LIBARCHIVE
     if (!loaded) {
@@ -329,36 +737,50 @@ void archive::iterate_archive(::archive *ar, int &idx, std::string const& root,
     }
     #endif
     ::archive_entry *entry;
-    int ret;
+    int ret = ARCHIVE_OK;
 
-    while ((ret = archive_read_next_header(ar, &entry)) == ARCHIVE_OK) {
-        mode_t type = archive_entry_filetype(entry);
-        if (type == AE_IFREG) {
-            const char *c_pathname = archive_entry_pathname(entry);
-            std::string pathname;
-            bool did_recurse = false;
-            if (c_pathname != nullptr) {
-                pathname = c_pathname;
-                #if SHIMEJIFINDER_HAS_UTF8_CONVERT
-                    if (!is_valid_utf8(pathname) && !shift_jis_to_utf8(pathname)) {
+    try {
+        while (!m_stopped &&
+            (ret = archive_read_next_header(ar, &entry)) == ARCHIVE_OK)
+        {
+            report_entry(input_position());
+            mode_t type = archive_entry_filetype(entry);
+            if (type == AE_IFREG) {
+                // only files count towards max_entries
+                guard().add_entry();
+                const char *c_pathname = archive_entry_pathname(entry);
+                std::string pathname;
+                bool did_recurse = false;
+                if (c_pathname != nullptr) {
+                    pathname = c_pathname;
+                    if (!convert_to_utf8(pathname)) {
                         // never allow invalid utf-8
                         continue;
                     }
-                #endif
-                pathname = root + pathname; 
-                did_recurse = try_recurse(idx, ar, entry, pathname, cb);
-            }
-            if (!did_recurse) {
-                cb(idx, ar, pathname);
-                ++idx;
+                    pathname = root + pathname; 
+                    did_recurse = try_recurse(idx, ar, entry, pathname, cb);
+                }
+                if (!did_recurse) {
+                    m_stopped = !cb(idx, ar, entry, pathname);
+                    ++idx;
+                }
             }
         }
     }
-    if (ret != ARCHIVE_EOF) {
+    catch (...) {
+        archive_read_free(ar);
+        throw;
+    }
+    if (!m_stopped && ret != ARCHIVE_EOF) {
         auto err = get_error(ar);
         archive_read_free(ar);
+        guard().rethrow_pending();
         throw std::runtime_error("archive_read_next_header() failed: " + err);
     }
+    if (root.empty() && !m_stopped) {
+        const char *format = archive_format_name(ar);
+        set_format_name(format != nullptr ? format : "");
+    }
     ret = archive_read_free(ar);
     if (ret != ARCHIVE_OK) {
         auto err = get_error(ar);
@@ -366,33 +788,483 @@ void archive::iterate_archive(::archive *ar, int &idx, std::string const& root,
     }
 }
 
+const char *archive::backend_name() const {
+    return "libarchive";
+}
+
+std::unordered_map<std::string, int64_t> archive::zip_offsets(
+    zip_directory const& directory)
+{
+    std::unordered_map<std::string, int64_t> offsets;
+    offsets.reserve(directory.entries().size());
+    for (auto &entry : directory.entries()) {
+        auto inserted = offsets.emplace(entry.name, (int64_t)entry.offset);
+        if (!inserted.second) {
+            // cannot tell which entry is which
+            inserted.first->second = -1;
+        }
+    }
+    return offsets;
+}
+
+archive_entry *archive::list_entry(int idx, std::string const& pathname,
+    int64_t size, int64_t mtime)
+{
+    add_fingerprint(pathname, size, mtime);
+    if (pathname.empty()) {
+        return nullptr;
+    }
+    auto fixed_name = pathname;
+    fix_japanese(fixed_name);
+    return add_entry(idx, fixed_name);
+}
+
+std::string archive::header_path(::archive_entry *header) {
+    const char *c_pathname = archive_entry_pathname(header);
+    std::string pathname = c_pathname != nullptr ? c_pathname : "";
+    if (!convert_to_utf8(pathname)) {
+        pathname.clear();
+    }
+    return pathname;
+}
+
+void archive::check_listed(archive_entry const& entry, std::string pathname) {
+    // entries are found by their index, an archive that is not read the
+    // same way it was listed would have the wrong files extracted
+    fix_japanese(pathname);
+    if (pathname != entry.path()) {
+        throw std::runtime_error("entry " + std::to_string(entry.index()) +
+            " is " + pathname + ", expected " + std::string { entry.path() });
+    }
+}
+
+void archive::read_listed(int idx, archive_entry &entry, ::archive *ar) {
+    if (retains_payloads()) {
+        // keep the whole entry so that extract() can be served
+        // without reading the archive again
+        begin_retain(idx);
+        bool success = read_data(ar, [this](long offset, const void *buf,
+            size_t size)
+        {
+            retain_next(offset, buf, size);
+            return true;
+        });
+        end_retain(success);
+        return;
+    }
+
+    // keep configuration files in memory so that analysis does not
+    // need to go through the archive again
+    size_t limit = capture_limit(entry);
+    if (limit > 0) {
+        std::string data;
+        if (read_data(ar, data, limit)) {
+            capture(idx, data);
+        }
+    }
+}
+
+// type of a zip entry as decided by libarchive
+static bool is_regular_file(zip_directory::entry const& entry) {
+    uint32_t mode = 0;
+    int system = entry.version_made_by >> 8;
+    if (system == 3) {
+        mode = entry.external_attributes >> 16;
+    }
+    else if (system == 0) {
+        // MS-DOS directory attribute
+        mode = (entry.external_attributes & 0x10) ? S_IFDIR : S_IFREG;
+    }
+    if ((mode & S_IFMT) != S_IFDIR) {
+        if (!entry.name.empty() && entry.name.back() == '/') {
+            return false;
+        }
+        if ((mode & S_IFMT) == 0) {
+            return true;
+        }
+    }
+    return (mode & S_IFMT) == S_IFREG;
+}
+
+// format name libarchive gives a zip file after reading the given entry
+static std::string zip_format_name(zip_directory::entry const& entry) {
+    static const std::pair<int, const char *> methods[] = {
+        { 0, "uncompressed" }, { 1, "shrinking" }, { 2, "reduced-1" },
+        { 3, "reduced-2" }, { 4, "reduced-3" }, { 5, "reduced-4" },
+        { 6, "imploded" }, { 7, "reserved" }, { 8, "deflation" },
+        { 9, "deflation-64-bit" }, { 10, "ibm-terse" }, { 11, "reserved" },
+        { 12, "bzip" }, { 13, "reserved" }, { 14, "lzma" },
+        { 15, "reserved" }, { 16, "reserved" }, { 17, "reserved" },
+        { 18, "ibm-terse-new" }, { 19, "ibm-lz777" }, { 93, "zstd" },
+        { 95, "xz" }, { 96, "jpeg" }, { 97, "wav-pack" }, { 98, "ppmd-1" },
+        { 99, "aes" }
+    };
+    const char *method = "??";
+    for (auto &known : methods) {
+        if (known.first == entry.method) {
+            method = known.second;
+            break;
+        }
+    }
+    int version = entry.version_needed & 0xFF;
+    return "ZIP " + std::to_string(version / 10) + "." +
+        std::to_string(version % 10) + " (" + method + ")";
+}
+
+// libarchive converts names flagged as utf-8 to the charset of the
+// locale, other names are passed through
+static bool keeps_utf8_name(std::string const& name) {
+    bool ascii = true;
+    for (char c : name) {
+        if ((unsigned char)c >= 0x80) {
+            ascii = false;
+            break;
+        }
+    }
+    if (ascii) {
+        return true;
+    }
+    #if SHIMEJIFINDER_HAS_UTF8_CONVERT
+        const char *codeset = nl_langinfo(CODESET);
+        return codeset != nullptr && strcmp(codeset, "UTF-8") == 0 &&
+            is_valid_utf8(name);
+    #else
+        return false;
+    #endif
+}
+
+bool archive::list_directory(zip_directory const& directory) {
+    // libarchive returns entries in the order of their local headers
+    std::vector<const zip_directory::entry *> entries;
+    entries.reserve(directory.entries().size());
+    for (auto &entry : directory.entries()) {
+        entries.push_back(&entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](
+        const zip_directory::entry *a, const zip_directory::entry *b)
+    {
+        return a->offset < b->offset;
+    });
+
+    // only list from the directory when the result is known to be the
+    // same as going through the file
+    if (entries.empty()) {
+        return false;
+    }
+    for (size_t i=0; i<entries.size(); ++i) {
+        auto &entry = *entries[i];
+        if (i > 0 && entries[i-1]->offset == entry.offset) {
+            return false;
+        }
+        if (entry.has_unicode_path) {
+            // libarchive uses the name from the extra field
+            return false;
+        }
+        if ((entry.flags & 0x800) && !keeps_utf8_name(entry.name)) {
+            return false;
+        }
+        if (!is_regular_file(entry)) {
+            continue;
+        }
+        auto ext = to_lower(file_extension(entry.name));
+        if ((ext == "zip" && to_lower(last_component(entry.name)) != "src.zip") ||
+            ext == "7z" || ext == "rar")
+        {
+            // nested archives are listed by going through the file
+            return false;
+        }
+    }
+
+    auto &source = input();
+    int idx = 0;
+    for (auto zip_entry : entries) {
+        report_entry(zip_entry->offset);
+        if (!is_regular_file(*zip_entry)) {
+            continue;
+        }
+        guard().add_entry();
+        std::string pathname = zip_entry->name;
+        if (!convert_to_utf8(pathname)) {
+            // never allow invalid utf-8
+            continue;
+        }
+        int entry_idx = idx++;
+        // times are left out of the fingerprint, see fill_entries()
+        auto entry = list_entry(entry_idx, pathname, zip_entry->size, 0);
+        if (entry == nullptr) {
+            continue;
+        }
+        entry->set_offset(zip_entry->offset);
+        if (capture_limit(*entry) == 0) {
+            continue;
+        }
+
+        // configuration files are read directly
+        direct_context ctx { source, zip_entry->offset };
+        ::archive_entry *header;
+        int ret = archive_read_next_header(ctx.archive(), &header);
+        if (ret == ARCHIVE_OK || ret == ARCHIVE_WARN) {
+            m_input = ctx.archive();
+            m_input_offset = zip_entry->offset;
+            try {
+                read_listed(entry_idx, *entry, ctx.archive());
+            }
+            catch (...) {
+                m_input = nullptr;
+                throw;
+            }
+            m_input = nullptr;
+        }
+    }
+    set_format_name(zip_format_name(*entries.back()));
+    return true;
+}
+
 void archive::fill_entries() {
-    iterate_archive([this](int idx, ::archive *ar, std::string const& pathname){
-        (void)ar;
-        if (pathname.empty()) {
-            return;
+    m_file = nullptr;
+    m_file_input.close();
+    zip_directory directory;
+    if (config().random_access && directory.read(input()) &&
+        !retains_payloads() && list_directory(directory))
+    {
+        return;
+    }
+    auto offsets = zip_offsets(directory);
+    iterate_archive([this, &offsets](int idx, ::archive *ar, ::archive_entry *header,
+        std::string const& pathname)
+    {
+        // list_directory() does not know the times libarchive gives zip
+        // entries, they are left out so that both listings match
+        int64_t mtime = archive_entry_mtime(header);
+        if (ar == m_input && is_zip(ar)) {
+            mtime = 0;
+        }
+        auto entry = list_entry(idx, pathname, archive_entry_size(header),
+            mtime);
+        if (entry == nullptr) {
+            return true;
+        }
+        if (ar == m_input && !offsets.empty()) {
+            // entries of nested archives cannot be read directly
+            auto offset = offsets.find(archive_entry_pathname(header));
+            if (offset != offsets.end()) {
+                entry->set_offset(offset->second);
+            }
         }
-        auto fixed_name = pathname;
-        fix_japanese(fixed_name);
-        add_entry({ idx, fixed_name });
+        read_listed(idx, *entry, ar);
+        return true;
     });
 }
 
-void archive::extract() {
-    size_t stored_idx = 0;
-    iterate_archive([this, &stored_idx](int idx, ::archive *ar, std::string const& pathname){
-        (void)pathname;
-        if (stored_idx >= size()) {
-            return;
+bool archive::plan_has_offsets() {
+    for (size_t i=0; i<plan().size(); ++i) {
+        if (plan()[i]->offset() < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool archive::reads_directly() {
+    // every entry read directly costs a new reader, going through the
+    // whole file is cheaper once a larger part of it is needed
+    if (!config().random_access || plan().size() * 8 > size()) {
+        return false;
+    }
+    return plan_has_offsets();
+}
+
+void archive::extract_directly() {
+    auto &source = input();
+    for (size_t i=0; i<plan().size(); ++i) {
+        auto entry = plan()[i];
+        direct_context ctx { source, (uint64_t)entry->offset() };
+        auto ar = ctx.archive();
+        m_input = ar;
+        m_input_offset = (uint64_t)entry->offset();
+        guard().add_entry();
+        report_entry(input_position());
+        ::archive_entry *header;
+        int ret = archive_read_next_header(ar, &header);
+        if (ret != ARCHIVE_OK && ret != ARCHIVE_WARN) {
+            m_input = nullptr;
+            throw std::runtime_error("archive_read_next_header() failed: " +
+                get_error(ar));
+        }
+        try {
+            check_listed(*entry, header_path(header));
+        }
+        catch (...) {
+            m_input = nullptr;
+            throw;
+        }
+        for (auto &target : entry->extract_targets()) {
+            begin_write(target);
         }
-        auto entry = at(stored_idx);
-        if (idx != entry->index()) {
+        try {
+            read_data(ar, [this](long offset, const void *buf, size_t size){
+                write_next(offset, buf, size);
+                return true;
+            });
+        }
+        catch (...) {
+            m_input = nullptr;
+            throw;
+        }
+        m_input = nullptr;
+        end_write();
+    }
+}
+
+bool archive::extracts_in_parallel() {
+    return config().extract_threads != 1 && config().random_access &&
+        plan().size() > 1 && plan_has_offsets();
+}
+
+// entries larger than this are written while they are decompressed,
+// holding the lock, instead of being buffered first
+static const size_t k_parallel_buffer_size = 4 * 1024 * 1024;
+
+void archive::extract_parallel_entry(parallel_state &state,
+    archive_entry &entry)
+{
+    auto offset = (uint64_t)entry.offset();
+    {
+        std::lock_guard<std::mutex> lock { state.lock };
+        if (state.failed) {
             return;
         }
-        ++stored_idx;
-        if (!entry->valid() || entry->extract_targets().empty()) {
+        guard().add_entry();
+        state.position = std::max(state.position, offset);
+        report_entry(state.position);
+    }
+    direct_context ctx { *state.input, offset };
+    auto ar = ctx.archive();
+    ::archive_entry *header;
+    int ret = archive_read_next_header(ar, &header);
+    if (ret != ARCHIVE_OK && ret != ARCHIVE_WARN) {
+        throw std::runtime_error("archive_read_next_header() failed: " +
+            get_error(ar));
+    }
+    {
+        std::lock_guard<std::mutex> lock { state.lock };
+        check_listed(entry, header_path(header));
+    }
+
+    // decompression is timed and counted locally and added to the
+    // archive's stats once the entry is written
+    std::unique_lock<std::mutex> writing { state.lock, std::defer_lock };
+    std::vector<uint8_t> buf;
+    la_int64_t size_hint = archive_entry_size(header);
+    if (size_hint > 0) {
+        buf.reserve(std::min((size_t)size_hint, k_parallel_buffer_size));
+    }
+    phase_stats decompression;
+    uint64_t decompressed = 0;
+    auto start_writing = [&](){
+        writing.lock();
+        if (state.failed) {
+            return false;
+        }
+        for (auto &target : entry.extract_targets()) {
+            begin_write(target);
+        }
+        if (!buf.empty()) {
+            write_next(0, &buf[0], buf.size());
+        }
+        return true;
+    };
+    la_int64_t start = archive_filter_bytes(ar, -1);
+    while (true) {
+        const void *block;
+        size_t size;
+        la_int64_t block_offset;
+        {
+            SHIMEJIFINDER_TIME_BLOCKS(decompression);
+            ret = archive_read_data_block(ar, &block, &size, &block_offset);
+        }
+        if (ret == ARCHIVE_EOF) {
+            break;
+        }
+        else if (ret != ARCHIVE_OK) {
+            std::cerr << "archive_read_data_block() failed: " << get_error(ar) << std::endl;
+            break;
+        }
+        SHIMEJIFINDER_COUNT(decompressed, size);
+        guard().check_ratio((uint64_t)block_offset + size,
+            archive_filter_bytes(ar, -1) - start);
+        if (writing.owns_lock()) {
+            guard().add_bytes(size);
+        }
+        else {
+            std::lock_guard<std::mutex> lock { state.lock };
+            guard().add_bytes(size);
+        }
+        size_t end = (size_t)block_offset + size;
+        if (!writing.owns_lock() && end > k_parallel_buffer_size &&
+            !start_writing())
+        {
             return;
         }
+        if (writing.owns_lock()) {
+            write_next((size_t)block_offset, block, size);
+        }
+        else {
+            if (buf.size() < end) {
+                buf.resize(end);
+            }
+            memcpy(buf.data() + block_offset, block, size);
+        }
+    }
+    if (!writing.owns_lock() && !start_writing()) {
+        return;
+    }
+    end_write();
+    stats().decompression += decompression;
+    SHIMEJIFINDER_COUNT(stats().bytes_decompressed, decompressed);
+}
+
+void archive::extract_parallel() {
+    // every thread reads its entries with its own reader, the input has
+    // no shared file position. the extractor is called by one thread at
+    // a time, so it sees each entry as a whole
+    parallel_state state;
+    state.input = &input();
+    parallel_for(plan().size(), config().extract_threads, [&](size_t i){
+        try {
+            extract_parallel_entry(state, *plan()[i]);
+        }
+        catch (...) {
+            // the other threads stop before touching the extractor
+            std::lock_guard<std::mutex> lock { state.lock };
+            state.failed = true;
+            throw;
+        }
+    });
+}
+
+void archive::extract() {
+    m_file = nullptr;
+    m_file_input.close();
+    if (extracts_in_parallel()) {
+        extract_parallel();
+        return;
+    }
+    if (reads_directly()) {
+        extract_directly();
+        return;
+    }
+    iterate_archive([this](int idx, ::archive *ar, ::archive_entry *header,
+        std::string const& pathname)
+    {
+        (void)header;
+        auto entry = plan().take(idx);
+        if (entry == nullptr) {
+            // seeks past the data where the format allows it
+            archive_read_data_skip(ar);
+            return true;
+        }
+        check_listed(*entry, pathname);
         for (auto &target : entry->extract_targets()) {
             begin_write(target);
         }
@@ -401,6 +1273,9 @@ void archive::extract() {
             return true;
         });
         end_write();
+
+        // nothing after the last needed entry has to be read
+        return !plan().done();
     });
 }
 
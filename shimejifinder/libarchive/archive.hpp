@@ -21,7 +21,12 @@
 #if !SHIMEJIFINDER_NO_LIBARCHIVE
 
 #include "../archive.hpp"
+#include "../input_source.hpp"
+#include "../zip_directory.hpp"
 #include <archive.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 #if SHIMEJIFINDER_DYNAMIC_LIBARCHIVE
 #include <archive_entry.h>
@@ -39,55 +44,146 @@ public:
     static ::archive *(*archive_read_new)();
     static int (*archive_read_support_filter_all)(::archive *);
     static int (*archive_read_support_format_all)(::archive *);
+    static int (*archive_read_support_format_zip_streamable)(::archive *);
     static int (*archive_read_free)(::archive *);
     static const char *(*archive_error_string)(::archive *);
     static int (*archive_read_next_header)(::archive *, ::archive_entry **);
     static mode_t (*archive_entry_filetype)(::archive_entry *);
     static int (*archive_read_data_skip)(::archive *);
     static const char *(*archive_entry_pathname)(::archive_entry *);
+    static la_int64_t (*archive_entry_size)(::archive_entry *);
+    static time_t (*archive_entry_mtime)(::archive_entry *);
     static int (*archive_read_open2)(::archive *a, void *, archive_open_callback *,
         archive_read_callback *, archive_skip_callback *, archive_close_callback *);
     static int (*archive_read_open_fd)(::archive *, int, size_t);
     static int (*archive_read_data_block)(::archive *, const void **, size_t *,
         la_int64_t *);
     static la_int64_t (*archive_seek_data)(::archive *, la_int64_t, int);
-    static int (*archive_read_open_memory)(::archive *, const void *, size_t);
+    static int (*archive_read_open_memory2)(::archive *, const void *, size_t,
+        size_t);
     static int (*archive_read_open_filename)(::archive *, const char *, size_t);
+    static const char *(*archive_format_name)(::archive *);
+    static la_int64_t (*archive_filter_bytes)(::archive *, int);
 
     static bool loaded;
 
     static const char *load(const char *path);
 #endif
 private:
+    // reads an archive nested in an entry of its parent. blocks of the
+    // parent are passed on without being copied, except to copy_fd if set
     class nested_context {
     private:
         ::archive *parent;
-        la_ssize_t offset;
+        uint64_t offset;
         ::archive *ar;
-        std::vector<uint8_t> buf;
+        const uint8_t *pending;
+        uint64_t pending_offset;
+        size_t pending_size;
+        resource_guard &guard;
+        archive_stats &stats;
+        la_int64_t parent_start;
+        int copy_fd;
+        uint64_t copy_limit;
+        uint64_t copy_size;
+        bool eof;
+        bool aborted;
+        bool next_block();
         bool read(la_int64_t *size, const void **out_buf);
+        la_int64_t skip(la_int64_t request);
         static int close_callback(::archive *ar, void *data);
         static la_int64_t skip_callback(::archive *ar, void *data, la_int64_t skip);
         static la_ssize_t read_callback(::archive *ar, void *data, const void **buf);
         static int open_callback(::archive *ar, void *data);
     public:
-        nested_context(::archive *parent);
+        nested_context(::archive *parent, resource_guard &guard,
+            archive_stats &stats, int copy_fd = -1, uint64_t copy_limit = 0);
+        ::archive *archive();
+
+        // reads the rest of the parent entry into the copy and stores its
+        // size. returns false if the copy is incomplete
+        bool finish_copy(uint64_t &size);
+    };
+
+    // reads a nested archive from its copy in the nested archive cache
+    class cached_context {
+    private:
+        input_source source;
+        uint64_t position;
+        ::archive *ar;
+        std::vector<uint8_t> buf;
+        static la_int64_t skip_callback(::archive *ar, void *data, la_int64_t skip);
+        static la_ssize_t read_callback(::archive *ar, void *data, const void **buf);
+    public:
+        explicit cached_context(int fd);
         ::archive *archive();
     };
 
+    // reads a single zip entry starting at its local file header
+    class direct_context {
+    private:
+        input_source const& source;
+        uint64_t position;
+        ::archive *ar;
+        std::vector<uint8_t> buf;
+        static la_int64_t skip_callback(::archive *ar, void *data, la_int64_t skip);
+        static la_ssize_t read_callback(::archive *ar, void *data, const void **buf);
+    public:
+        direct_context(input_source const& source, uint64_t offset);
+        direct_context(direct_context const&) = delete;
+        direct_context &operator=(direct_context const&) = delete;
+        ~direct_context();
+        ::archive *archive();
+    };
+
+    // shared by the threads of extract_parallel(), only used while
+    // holding the lock
+    struct parallel_state {
+        input_source const *input;
+        std::mutex lock;
+        uint64_t position = 0;
+        bool failed = false;
+    };
+
+    ::archive *m_input = nullptr;
+    uint64_t m_input_offset = 0;
+    bool m_stopped = false;
+    FILE *m_file = nullptr;
+    input_source m_file_input;
     static std::string get_error(::archive *ar);
+    static bool is_zip(::archive *ar);
+    uint64_t input_position();
+    FILE *input_file();
+    input_source const& input();
+    static std::unordered_map<std::string, int64_t> zip_offsets(
+        zip_directory const& directory);
+    archive_entry *list_entry(int idx, std::string const& pathname,
+        int64_t size, int64_t mtime);
+    std::string header_path(::archive_entry *header);
+    void check_listed(archive_entry const& entry, std::string pathname);
+    void read_listed(int idx, archive_entry &entry, ::archive *ar);
+    bool list_directory(zip_directory const& directory);
+    bool plan_has_offsets();
+    bool reads_directly();
+    void extract_directly();
+    bool extracts_in_parallel();
+    void extract_parallel();
+    void extract_parallel_entry(parallel_state &state, archive_entry &entry);
     bool read_data(::archive *ar, std::function<bool (long, const void *, size_t)> cb);
-    bool read_data(::archive *ar, std::ostream &out, size_t max_size = SIZE_MAX);
+    bool read_data(::archive *ar, std::string &out, size_t max_size = SIZE_MAX);
     bool try_recurse(int &idx, ::archive *, ::archive_entry *, std::string const& pathname,
-        std::function<void (int, ::archive *, std::string const&)> &cb);
-    void iterate_archive(std::function<void (int, ::archive *,
-        std::string const&)> cb);
+        std::function<bool (int, ::archive *, ::archive_entry *, std::string const&)> &cb);
+    void iterate_archive(std::function<bool (int, ::archive *,
+        ::archive_entry *, std::string const&)> cb);
     void iterate_archive(::archive *ar, int &idx, std::string const& root,
-        std::function<void (int, ::archive *, std::string const&)> &cb);
+        std::function<bool (int, ::archive *, ::archive_entry *, std::string const&)> &cb);
+    static int archive_open(::archive *ar, input_source const& memory);
     int archive_open(::archive *ar);
 protected:
     void fill_entries() override;
     void extract() override;
+public:
+    const char *backend_name() const override;
 };
 
 }
@@ -24,14 +24,17 @@
 #include <cstdio>
 #include <unarr.h>
 #include <functional>
+#include <string>
+#include <vector>
+#include <cstring>
 #include "unarr_FILE.h"
-#include "../utf8_convert.hpp"
 
-static ar_archive *ar_open_any_archive(ar_stream *stream) {
+static ar_archive *ar_open_any_archive(ar_stream *stream, const char **format) {
     ar_archive *ar = ar_open_rar_archive(stream);
-    if (!ar) ar = ar_open_zip_archive(stream, false);
-    if (!ar) ar = ar_open_7z_archive(stream);
-    if (!ar) ar = ar_open_tar_archive(stream);
+    *format = "rar";
+    if (!ar) { ar = ar_open_zip_archive(stream, false); *format = "zip"; }
+    if (!ar) { ar = ar_open_7z_archive(stream); *format = "7z"; }
+    if (!ar) { ar = ar_open_tar_archive(stream); *format = "tar"; }
     return ar;
 }
 
@@ -40,7 +43,11 @@ namespace libunarr {
 
 ar_stream *archive::open_stream() {
     ar_stream *stream;
-    if (has_filename()) {
+    auto &memory = memory_input();
+    if (memory.in_memory()) {
+        stream = ar_open_memory(memory.data(), (size_t)memory.size());
+    }
+    else if (has_filename()) {
         auto name = filename();
         stream = ar_open_file(name.c_str());
     }
@@ -50,73 +57,147 @@ ar_stream *archive::open_stream() {
     return stream;
 }
 
-void archive::iterate_archive(std::function<void (int, ar_archive *)> cb) {
-    ar_stream *stream = open_stream();
-    if (stream == nullptr) {
-        throw std::runtime_error("open_stream() failed");
+void archive::iterate_archive(std::function<bool (int, ar_archive *)> cb) {
+    ar_stream *stream;
+    const char *format;
+    ar_archive *archive;
+    {
+        SHIMEJIFINDER_TIME_PHASE(stats().open);
+        stream = open_stream();
+        if (stream == nullptr) {
+            throw std::runtime_error("open_stream() failed");
+        }
+        archive = ar_open_any_archive(stream, &format);
     }
-    ar_archive *archive = ar_open_any_archive(stream);
     if (archive == nullptr) {
         ar_close(stream);
         throw std::runtime_error("ar_open_any_archive() failed");
     }
-    for (int i=0; ar_parse_entry(archive); ++i) {
-        cb(i, archive);
+    set_format_name(format);
+    m_stream = stream;
+    try {
+        for (int i=0; ar_parse_entry(archive); ++i) {
+            guard().add_entry();
+            report_entry(ar_tell(stream));
+            if (!cb(i, archive)) {
+                break;
+            }
+        }
     }
+    catch (...) {
+        m_stream = nullptr;
+        ar_close_archive(archive);
+        ar_close(stream);
+        throw;
+    }
+    m_stream = nullptr;
     ar_close_archive(archive);
     ar_close(stream);
 }
 
+const char *archive::backend_name() const {
+    return "libunarr";
+}
+
 void archive::fill_entries() {
     iterate_archive([this](int idx, ar_archive *ar) {
         const char *c_pathname = ar_entry_get_name(ar);
         if (c_pathname == nullptr) {
             c_pathname = ar_entry_get_raw_name(ar);
             if (c_pathname == nullptr) {
-                return;
+                return true;
             }
         }
         std::string pathname = c_pathname;
-        #if SHIMEJIFINDER_HAS_UTF8_CONVERT
-            if (!is_valid_utf8(pathname) && !shift_jis_to_utf8(pathname)) {
-                // never allow invalid utf-8
-                return;
+        add_fingerprint(pathname, ar_entry_get_size(ar),
+            ar_entry_get_filetime(ar));
+        if (!convert_to_utf8(pathname)) {
+            // never allow invalid utf-8
+            return true;
+        }
+        auto entry = add_entry(idx, pathname);
+        if (entry == nullptr) {
+            return true;
+        }
+        size_t size = ar_entry_get_size(ar);
+
+        if (retains_payloads()) {
+            // keep the whole entry so that extract() can be served
+            // without reading the archive again
+            begin_retain(idx, size);
+            bool success = read_data(ar, [this](size_t offset, const void *buf,
+                size_t size)
+            {
+                retain_next(offset, buf, size);
+            });
+            end_retain(success);
+            return true;
+        }
+
+        // keep configuration files in memory so that analysis does not
+        // need to go through the archive again
+        size_t limit = capture_limit(*entry);
+        if (limit > 0 && size <= limit) {
+            std::string data(size, '\0');
+            bool success = read_data(ar, [&data](size_t offset, const void *buf,
+                size_t size)
+            {
+                memcpy(&data[offset], buf, size);
+            });
+            if (success) {
+                capture(idx, data);
             }
-        #endif
-        add_entry({ idx, pathname });
+        }
+        return true;
     });
 }
 
-void archive::extract() {
+bool archive::read_data(ar_archive *ar,
+    std::function<void (size_t, const void *, size_t)> cb)
+{
     std::vector<uint8_t> data(10240);
-    size_t stored_idx = 0;
-    iterate_archive([this, &data, &stored_idx](int idx, ar_archive *ar) {
-        if (stored_idx >= size()) {
-            return;
+    size_t remaining = ar_entry_get_size(ar);
+    size_t offset = 0;
+    int64_t start = ar_tell(m_stream);
+    while (remaining > 0) {
+        size_t read = std::min(data.size(), remaining);
+        bool ok;
+        {
+            SHIMEJIFINDER_TIME_BLOCKS(stats().decompression);
+            ok = ar_entry_uncompress(ar, &data[0], read);
         }
-        auto entry = at(stored_idx);
-        if (idx != entry->index()) {
-            return;
+        if (!ok) {
+            return false;
         }
-        ++stored_idx;
-        if (!entry->valid() || entry->extract_targets().empty()) {
-            return;
+        SHIMEJIFINDER_COUNT(stats().bytes_decompressed, read);
+        guard().add_bytes(read);
+        guard().check_ratio(offset + read, ar_tell(m_stream) - start);
+        report_progress(ar_tell(m_stream));
+        cb(offset, &data[0], read);
+        offset += read;
+        remaining -= read;
+    }
+    return true;
+}
+
+void archive::extract() {
+    iterate_archive([this](int idx, ar_archive *ar) {
+        // unarr only decompresses entries that are read, parsing the next
+        // entry skips the data of this one
+        auto entry = plan().take(idx);
+        if (entry == nullptr) {
+            return true;
         }
         for (auto &target : entry->extract_targets()) {
             begin_write(target);
         }
-        size_t remaining = ar_entry_get_size(ar);
-        size_t offset = 0;
-        while (remaining > 0) {
-            size_t read = std::min(data.size(), remaining);
-            if (!ar_entry_uncompress(ar, &data[0], read)) {
-                break;
-            }
-            write_next(offset, &data[0], read);
-            offset += read;
-            remaining -= read;
-        }
+        read_data(ar, [this](size_t offset, const void *buf, size_t size){
+            write_next(offset, buf, size);
+        });
         end_write();
+
+        // nothing after the last needed entry has to be read
+        return !plan().done();
     });
 }
 
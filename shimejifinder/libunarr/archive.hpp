@@ -34,8 +34,12 @@ class archive : public shimejifinder::archive {
 protected:
     void fill_entries() override;
     void extract() override;
+public:
+    const char *backend_name() const override;
 private:
-    void iterate_archive(std::function<void (int, ar_archive *)> cb);
+    ar_stream *m_stream = nullptr;
+    void iterate_archive(std::function<bool (int, ar_archive *)> cb);
+    bool read_data(ar_archive *ar, std::function<void (size_t, const void *, size_t)> cb);
     ar_stream *open_stream();
 };
 
@@ -0,0 +1,56 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "name_pool.hpp"
+
+namespace shimejifinder {
+
+name_pool::name_pool() {}
+
+const std::string *name_pool::intern(std::string_view name) {
+    if (name.empty()) {
+        return empty();
+    }
+    std::lock_guard<std::mutex> lock { m_lock };
+    auto iter = m_names.find(name);
+    if (iter != m_names.end()) {
+        return iter->second.get();
+    }
+    auto stored = std::make_unique<std::string>(name);
+    auto ptr = stored.get();
+    // the key points into the stored string, which never moves
+    m_names.emplace(std::string_view { *ptr }, std::move(stored));
+    return ptr;
+}
+
+size_t name_pool::size() {
+    std::lock_guard<std::mutex> lock { m_lock };
+    return m_names.size();
+}
+
+void name_pool::clear() {
+    std::lock_guard<std::mutex> lock { m_lock };
+    m_names.clear();
+}
+
+const std::string *name_pool::empty() {
+    static const std::string name;
+    return &name;
+}
+
+}
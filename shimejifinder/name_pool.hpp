@@ -0,0 +1,49 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace shimejifinder {
+
+/// Names used by the extract targets of an archive. Every distinct name
+/// is stored once, and the returned pointers stay valid until the pool is
+/// cleared. intern() may be called from multiple threads.
+class name_pool {
+private:
+    std::mutex m_lock;
+    std::unordered_map<std::string_view, std::unique_ptr<std::string>>
+        m_names;
+public:
+    name_pool();
+    name_pool(name_pool const&) = delete;
+    name_pool &operator=(name_pool const&) = delete;
+    const std::string *intern(std::string_view name);
+    size_t size();
+    void clear();
+
+    /// Empty name shared by all pools.
+    static const std::string *empty();
+};
+
+}
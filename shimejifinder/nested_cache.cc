@@ -0,0 +1,96 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "nested_cache.hpp"
+#include <unistd.h>
+
+namespace shimejifinder {
+
+nested_cache::nested_cache(): m_size(0), m_complete(false) {}
+
+nested_cache::~nested_cache() {
+    clear();
+}
+
+void nested_cache::clear() {
+    for (auto &pair : m_archives) {
+        if (pair.second.fd != -1) {
+            close(pair.second.fd);
+        }
+    }
+    m_archives.clear();
+    m_size = 0;
+    m_complete = false;
+}
+
+uint64_t nested_cache::size() const {
+    return m_size;
+}
+
+void nested_cache::add(int idx, std::string const& path) {
+    if (m_complete) {
+        return;
+    }
+    auto inserted = m_archives.insert({ { idx, path }, { -1, 0, false } });
+    if (inserted.second) {
+        return;
+    }
+    // cannot tell which copy belongs to which archive in later passes
+    auto &cached = inserted.first->second;
+    if (cached.fd != -1) {
+        close(cached.fd);
+        m_size -= cached.size;
+    }
+    cached = { -1, 0, true };
+}
+
+bool nested_cache::insert(int idx, std::string const& path, int fd,
+    uint64_t size, uint64_t limit)
+{
+    auto it = m_archives.find({ idx, path });
+    if (fd == -1 || m_complete || it == m_archives.end() ||
+        it->second.duplicate || it->second.fd != -1 ||
+        m_size + size > limit)
+    {
+        return false;
+    }
+    it->second.fd = fd;
+    it->second.size = size;
+    m_size += size;
+    return true;
+}
+
+void nested_cache::complete() {
+    m_complete = true;
+}
+
+int nested_cache::find(int idx, std::string const& path,
+    uint64_t &size) const
+{
+    if (!m_complete) {
+        return -1;
+    }
+    auto it = m_archives.find({ idx, path });
+    if (it == m_archives.end() || it->second.fd == -1) {
+        return -1;
+    }
+    size = it->second.size;
+    return it->second.fd;
+}
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace shimejifinder {
+
+/// Keeps copies of nested archives after they are first read from their
+/// parent, so that later passes over the same archive can read them
+/// without decompressing the parent entry again. Each copy is stored in
+/// its own spill file, keyed by the index of the first entry of the nested
+/// archive and its path. Copies are only made during the first pass and
+/// only found after it. Nested archives that share a key are never cached.
+class nested_cache {
+private:
+    struct cached_archive {
+        int fd;
+        uint64_t size;
+        bool duplicate;
+    };
+    std::map<std::pair<int, std::string>, cached_archive> m_archives;
+    uint64_t m_size;
+    bool m_complete;
+public:
+    nested_cache();
+    nested_cache(nested_cache const&) = delete;
+    nested_cache &operator=(nested_cache const&) = delete;
+    ~nested_cache();
+
+    /// Closes every cached copy and starts a new first pass.
+    void clear();
+
+    /// Total size of the cached copies in bytes.
+    uint64_t size() const;
+
+    /// Records that the first pass reads the nested archive at path, whose
+    /// entries start at index idx. If the same archive is recorded twice,
+    /// its copy is closed and it is never cached.
+    void add(int idx, std::string const& path);
+
+    /// Takes ownership of fd, which holds the size bytes of a nested
+    /// archive recorded with add(). Returns false and leaves fd to the
+    /// caller if the copy would grow the cache past limit, the archive was
+    /// recorded twice, is already cached or the first pass is over.
+    bool insert(int idx, std::string const& path, int fd, uint64_t size,
+        uint64_t limit);
+
+    /// Ends the first pass.
+    void complete();
+
+    /// Returns the descriptor of the copy of the nested archive at path
+    /// whose entries start at idx and stores its size, or -1 if it is not
+    /// cached or the first pass is not over. The descriptor stays owned by
+    /// the cache.
+    int find(int idx, std::string const& path, uint64_t &size) const;
+};
+
+}
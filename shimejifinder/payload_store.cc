@@ -0,0 +1,179 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "payload_store.hpp"
+#include "utils.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <iostream>
+#include <vector>
+
+namespace shimejifinder {
+
+payload_store::payload_store(): m_memory_limit(0), m_memory_size(0),
+    m_spill_fd(-1), m_spill_size(0), m_active_idx(-1),
+    m_active_spilled(false), m_active_size(0) {}
+
+payload_store::~payload_store() {
+    clear();
+}
+
+void payload_store::reset(size_t memory_limit, std::string const& spill_dir) {
+    clear();
+    m_memory_limit = memory_limit;
+    m_spill_dir = spill_dir;
+}
+
+void payload_store::clear() {
+    m_memory.clear();
+    m_spilled.clear();
+    m_memory_size = 0;
+    m_active.clear();
+    m_active_idx = -1;
+    close_spill_file();
+}
+
+bool payload_store::open_spill_file() {
+    if (m_spill_fd != -1) {
+        return true;
+    }
+    m_spill_fd = create_spill_file(m_spill_dir);
+    if (m_spill_fd == -1) {
+        std::cerr << "shimejifinder: payload_store: could not create "
+            "spill file" << std::endl;
+        return false;
+    }
+    m_spill_size = 0;
+    return true;
+}
+
+void payload_store::close_spill_file() {
+    if (m_spill_fd != -1) {
+        close(m_spill_fd);
+        m_spill_fd = -1;
+    }
+    m_spill_size = 0;
+}
+
+bool payload_store::contains(int idx) const {
+    return m_memory.count(idx) == 1 || m_spilled.count(idx) == 1;
+}
+
+bool payload_store::begin(int idx, uint64_t size_hint) {
+    m_active_idx = idx;
+    m_active_size = 0;
+    m_active.clear();
+    m_active_spilled = m_memory_size + size_hint > m_memory_limit;
+    if (m_active_spilled && !open_spill_file()) {
+        m_active_idx = -1;
+        return false;
+    }
+    return true;
+}
+
+bool payload_store::write_next(uint64_t offset, const void *buf, size_t size) {
+    if (m_active_idx == -1) {
+        return false;
+    }
+    if (!m_active_spilled && m_memory_size + offset + size > m_memory_limit) {
+        // payload grew past the memory limit, move it to the spill file
+        if (!open_spill_file()) {
+            m_active_idx = -1;
+            return false;
+        }
+        m_active_spilled = true;
+        if (!m_active.empty() && pwrite(m_spill_fd, &m_active[0],
+            m_active.size(), m_spill_size) != (ssize_t)m_active.size())
+        {
+            m_active_idx = -1;
+            return false;
+        }
+        m_active.clear();
+        m_active.shrink_to_fit();
+    }
+    if (m_active_spilled) {
+        const char *data = (const char *)buf;
+        size_t written = 0;
+        while (written < size) {
+            ssize_t ret = pwrite(m_spill_fd, data + written, size - written,
+                m_spill_size + offset + written);
+            if (ret <= 0) {
+                m_active_idx = -1;
+                return false;
+            }
+            written += ret;
+        }
+    }
+    else {
+        if (m_active.size() < offset + size) {
+            m_active.resize(offset + size);
+        }
+        memcpy(&m_active[offset], buf, size);
+    }
+    if (offset + size > m_active_size) {
+        m_active_size = offset + size;
+    }
+    return true;
+}
+
+void payload_store::end(bool success) {
+    if (m_active_idx != -1 && success) {
+        if (m_active_spilled) {
+            m_spilled[m_active_idx] = { m_spill_size, m_active_size };
+            m_spill_size += m_active_size;
+        }
+        else {
+            m_memory_size += m_active.size();
+            m_memory[m_active_idx] = std::move(m_active);
+        }
+    }
+    m_active.clear();
+    m_active_idx = -1;
+}
+
+bool payload_store::read(int idx,
+    std::function<void (uint64_t, const void *, size_t)> cb) const
+{
+    if (m_memory.count(idx) == 1) {
+        auto &data = m_memory.at(idx);
+        cb(0, data.c_str(), data.size());
+        return true;
+    }
+    if (m_spilled.count(idx) == 0) {
+        return false;
+    }
+    auto &payload = m_spilled.at(idx);
+    std::vector<char> buf(std::min<uint64_t>(payload.size, 65536));
+    uint64_t offset = 0;
+    while (offset < payload.size) {
+        size_t size = std::min<uint64_t>(buf.size(), payload.size - offset);
+        ssize_t ret = pread(m_spill_fd, &buf[0], size, payload.offset + offset);
+        if (ret <= 0) {
+            return false;
+        }
+        cb(offset, &buf[0], ret);
+        offset += ret;
+    }
+    return true;
+}
+
+}
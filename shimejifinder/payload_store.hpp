@@ -0,0 +1,64 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <string>
+#include <map>
+#include <functional>
+#include <cstdint>
+
+namespace shimejifinder {
+
+/// Holds decompressed entry contents keyed by entry index. Contents are
+/// kept in memory until the memory limit is reached, after which they
+/// are appended to a temporary file.
+class payload_store {
+private:
+    struct spilled_payload {
+        uint64_t offset;
+        uint64_t size;
+    };
+    size_t m_memory_limit;
+    size_t m_memory_size;
+    std::string m_spill_dir;
+    int m_spill_fd;
+    uint64_t m_spill_size;
+    std::map<int, std::string> m_memory;
+    std::map<int, spilled_payload> m_spilled;
+    int m_active_idx;
+    bool m_active_spilled;
+    std::string m_active;
+    uint64_t m_active_size;
+    bool open_spill_file();
+    void close_spill_file();
+public:
+    payload_store();
+    payload_store(payload_store const&) = delete;
+    payload_store &operator=(payload_store const&) = delete;
+    ~payload_store();
+    void reset(size_t memory_limit, std::string const& spill_dir);
+    void clear();
+    bool contains(int idx) const;
+    bool begin(int idx, uint64_t size_hint = 0);
+    bool write_next(uint64_t offset, const void *buf, size_t size);
+    void end(bool success);
+    bool read(int idx, std::function<void (uint64_t, const void *, size_t)> cb) const;
+};
+
+}
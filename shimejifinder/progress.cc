@@ -0,0 +1,33 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "progress.hpp"
+
+namespace shimejifinder {
+
+cancellation_token::cancellation_token(): m_cancelled(false) {}
+
+void cancellation_token::cancel() {
+    m_cancelled = true;
+}
+
+bool cancellation_token::cancelled() const {
+    return m_cancelled;
+}
+
+}
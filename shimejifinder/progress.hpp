@@ -0,0 +1,66 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace shimejifinder {
+
+/// Progress of the operation that is reading an archive.
+struct progress {
+    enum class stage_type {
+        /// The archive is being listed by open() or analyze().
+        LISTING,
+
+        /// Files are being written by extract(), or by analyze() for
+        /// configuration files that were not kept while listing.
+        EXTRACTING
+    };
+
+    stage_type stage = stage_type::LISTING;
+
+    /// Entries listed so far while listing, files written so far while
+    /// extracting.
+    size_t entries = 0;
+
+    /// Number of files that will be written while extracting, 0 while
+    /// listing.
+    size_t total_entries = 0;
+
+    /// Bytes of the archive file read so far.
+    uint64_t bytes = 0;
+
+    /// Size of the archive file, 0 if unknown.
+    uint64_t total_bytes = 0;
+};
+
+/// Shared between the caller and the archive being read. Cancelling it
+/// stops the operation after the current entry or data block.
+class cancellation_token {
+private:
+    std::atomic<bool> m_cancelled;
+public:
+    cancellation_token();
+    void cancel();
+    bool cancelled() const;
+};
+
+}
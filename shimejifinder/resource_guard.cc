@@ -0,0 +1,137 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "resource_guard.hpp"
+
+namespace shimejifinder {
+
+// compressed sizes are estimated from the bytes read from the input,
+// which are read ahead in blocks. this allowance keeps small entries
+// that were read together with their header from tripping the ratio.
+static const uint64_t k_ratio_allowance = 1024 * 1024;
+
+read_aborted::read_aborted(std::string const& what):
+    std::runtime_error(what) {}
+
+limit_exceeded::limit_exceeded(limit_type type, std::string const& what):
+    read_aborted(what), m_type(type) {}
+
+limit_exceeded::limit_type limit_exceeded::type() const {
+    return m_type;
+}
+
+operation_cancelled::operation_cancelled():
+    read_aborted("operation cancelled") {}
+
+resource_guard::resource_guard(): m_max_entries(0), m_max_total_bytes(0),
+    m_max_compression_ratio(0), m_max_nesting_depth(0),
+    m_has_deadline(false), m_entries(0), m_total_bytes(0), m_depth(0) {}
+
+void resource_guard::reset(analyze_config const& config) {
+    m_max_entries = config.max_entries;
+    m_max_total_bytes = config.max_total_bytes;
+    m_max_compression_ratio = config.max_compression_ratio;
+    m_max_nesting_depth = config.max_nesting_depth;
+    m_has_deadline = config.max_wall_time_ms != 0;
+    m_deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(config.max_wall_time_ms);
+    m_entries = 0;
+    m_total_bytes = 0;
+    m_depth = 0;
+    m_cancellation = config.cancellation;
+    m_pending = nullptr;
+}
+
+void resource_guard::add_entry() {
+    ++m_entries;
+    if (m_max_entries != 0 && m_entries > m_max_entries) {
+        throw limit_exceeded(limit_exceeded::limit_type::ENTRIES,
+            "archive has more than " + std::to_string(m_max_entries) +
+            " entries");
+    }
+    check_time();
+    check_cancelled();
+}
+
+void resource_guard::add_bytes(uint64_t size) {
+    m_total_bytes += size;
+    if (m_max_total_bytes != 0 && m_total_bytes > m_max_total_bytes) {
+        throw limit_exceeded(limit_exceeded::limit_type::TOTAL_BYTES,
+            "archive decompresses to more than " +
+            std::to_string(m_max_total_bytes) + " bytes");
+    }
+    check_time();
+    check_cancelled();
+}
+
+void resource_guard::check_ratio(uint64_t uncompressed,
+    uint64_t compressed) const
+{
+    if (m_max_compression_ratio == 0) {
+        return;
+    }
+    if (uncompressed / m_max_compression_ratio >
+        compressed + k_ratio_allowance)
+    {
+        throw limit_exceeded(limit_exceeded::limit_type::COMPRESSION_RATIO,
+            "entry exceeds compression ratio of " +
+            std::to_string(m_max_compression_ratio));
+    }
+}
+
+void resource_guard::check_time() const {
+    if (m_has_deadline && std::chrono::steady_clock::now() > m_deadline) {
+        throw limit_exceeded(limit_exceeded::limit_type::WALL_TIME,
+            "time limit exceeded");
+    }
+}
+
+void resource_guard::check_cancelled() const {
+    if (m_cancellation != nullptr && m_cancellation->cancelled()) {
+        throw operation_cancelled();
+    }
+}
+
+void resource_guard::enter_nested() {
+    if (m_max_nesting_depth != 0 && m_depth >= m_max_nesting_depth) {
+        throw limit_exceeded(limit_exceeded::limit_type::NESTING_DEPTH,
+            "archive is nested more than " +
+            std::to_string(m_max_nesting_depth) + " levels deep");
+    }
+    ++m_depth;
+}
+
+void resource_guard::leave_nested() {
+    --m_depth;
+}
+
+void resource_guard::set_pending() {
+    if (m_pending == nullptr) {
+        m_pending = std::current_exception();
+    }
+}
+
+void resource_guard::rethrow_pending() {
+    if (m_pending != nullptr) {
+        auto ex = m_pending;
+        m_pending = nullptr;
+        std::rethrow_exception(ex);
+    }
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "analyze_config.hpp"
+
+namespace shimejifinder {
+
+/// Thrown when reading an archive is stopped before it is complete.
+class read_aborted : public std::runtime_error {
+public:
+    explicit read_aborted(std::string const& what);
+};
+
+/// Thrown when an archive exceeds one of the limits in analyze_config.
+class limit_exceeded : public read_aborted {
+public:
+    enum class limit_type {
+        ENTRIES,
+        TOTAL_BYTES,
+        COMPRESSION_RATIO,
+        NESTING_DEPTH,
+        WALL_TIME
+    };
+private:
+    limit_type m_type;
+public:
+    limit_exceeded(limit_type type, std::string const& what);
+    limit_type type() const;
+};
+
+/// Thrown when the cancellation token in analyze_config is cancelled.
+class operation_cancelled : public read_aborted {
+public:
+    operation_cancelled();
+};
+
+/// Keeps track of the resources used while an archive is read and throws
+/// limit_exceeded as soon as one of the configured limits is reached, or
+/// operation_cancelled once the operation is cancelled.
+class resource_guard {
+private:
+    size_t m_max_entries;
+    uint64_t m_max_total_bytes;
+    uint64_t m_max_compression_ratio;
+    size_t m_max_nesting_depth;
+    bool m_has_deadline;
+    std::chrono::steady_clock::time_point m_deadline;
+    size_t m_entries;
+    uint64_t m_total_bytes;
+    size_t m_depth;
+    std::shared_ptr<cancellation_token> m_cancellation;
+    std::exception_ptr m_pending;
+public:
+    resource_guard();
+    void reset(analyze_config const& config);
+    void add_entry();
+    void add_bytes(uint64_t size);
+    void check_ratio(uint64_t uncompressed, uint64_t compressed) const;
+    void check_time() const;
+    void check_cancelled() const;
+    void enter_nested();
+    void leave_nested();
+
+    /// Stores the exception being handled so that it can be rethrown once
+    /// control has returned from a C library callback.
+    void set_pending();
+
+    /// Rethrows the exception stored by set_pending(), if any.
+    void rethrow_pending();
+};
+
+}
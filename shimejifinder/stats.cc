@@ -0,0 +1,53 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "stats.hpp"
+#include <time.h>
+
+namespace shimejifinder {
+
+phase_stats &phase_stats::operator+=(phase_stats const& other) {
+    wall_ns += other.wall_ns;
+    cpu_ns += other.cpu_ns;
+    return *this;
+}
+
+uint64_t phase_timer::thread_cpu_ns() {
+    #ifdef CLOCK_THREAD_CPUTIME_ID
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+    #endif
+    return 0;
+}
+
+phase_timer::phase_timer(phase_stats &phase, bool cpu): m_phase(phase),
+    m_cpu(cpu), m_wall_start(std::chrono::steady_clock::now()),
+    m_cpu_start(cpu ? thread_cpu_ns() : 0) {}
+
+phase_timer::~phase_timer() {
+    auto wall = std::chrono::steady_clock::now() - m_wall_start;
+    m_phase.wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        wall).count();
+    if (m_cpu) {
+        m_phase.cpu_ns += thread_cpu_ns() - m_cpu_start;
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <chrono>
+#include <cstdint>
+
+namespace shimejifinder {
+
+/// Time spent in one phase of reading an archive. Phases that run on
+/// multiple threads are summed over all threads.
+struct phase_stats {
+    uint64_t wall_ns = 0;
+
+    /// CPU time of the thread doing the work. Not measured for
+    /// decompression and writes, which are timed for every data block.
+    uint64_t cpu_ns = 0;
+
+    phase_stats &operator+=(phase_stats const& other);
+};
+
+/// Timing and counters collected by open(), analyze() and extract(). Reset
+/// when the archive is opened. All values stay 0 when the library is built
+/// with SHIMEJIFINDER_NO_STATS.
+struct archive_stats {
+    /// Opening the archive file and detecting its format, for every pass
+    /// over the archive.
+    phase_stats open;
+
+    /// Listing the archive, including opening it and decompressing the
+    /// entries captured while listing.
+    phase_stats listing;
+
+    /// Converting entry names from Shift-JIS.
+    phase_stats utf8_convert;
+
+    /// Extracting configuration files during analysis.
+    phase_stats xml_extract;
+
+    /// Scanning configuration files for referenced files.
+    phase_stats find_paths;
+
+    /// Resolving referenced files in the archive.
+    phase_stats path_resolution;
+
+    /// extract(), including decompression and writes. The extraction done
+    /// by analyze() is counted as xml_extract instead.
+    phase_stats extract;
+
+    /// Reading decompressed data from the backend.
+    phase_stats decompression;
+
+    /// Passing data to the extractor.
+    phase_stats writes;
+
+    /// Files with a name passed to add_entry().
+    uint64_t entries_seen = 0;
+
+    /// Files kept by add_entry().
+    uint64_t entries_kept = 0;
+
+    uint64_t bytes_decompressed = 0;
+    uint64_t bytes_written = 0;
+    uint64_t nested_archives = 0;
+    uint64_t encoding_conversions = 0;
+
+    /// Backends that failed to open the archive before one succeeded.
+    uint64_t backend_fallbacks = 0;
+};
+
+/// Adds the time from its construction to its destruction to a phase.
+class phase_timer {
+private:
+    phase_stats &m_phase;
+    bool m_cpu;
+    std::chrono::steady_clock::time_point m_wall_start;
+    uint64_t m_cpu_start;
+    static uint64_t thread_cpu_ns();
+public:
+    explicit phase_timer(phase_stats &phase, bool cpu = true);
+    phase_timer(phase_timer const&) = delete;
+    phase_timer &operator=(phase_timer const&) = delete;
+    ~phase_timer();
+};
+
+}
+
+#if SHIMEJIFINDER_NO_STATS
+#define SHIMEJIFINDER_TIME_PHASE(phase)
+#define SHIMEJIFINDER_TIME_BLOCKS(phase)
+#define SHIMEJIFINDER_COUNT(counter, amount) ((void)(amount))
+#else
+#define SHIMEJIFINDER_STATS_CONCAT2(a, b) a##b
+#define SHIMEJIFINDER_STATS_CONCAT(a, b) SHIMEJIFINDER_STATS_CONCAT2(a, b)
+
+/// Times the rest of the enclosing scope.
+#define SHIMEJIFINDER_TIME_PHASE(phase) \
+    ::shimejifinder::phase_timer SHIMEJIFINDER_STATS_CONCAT(phase_timer_, \
+        __LINE__) { phase }
+
+/// Times the rest of the enclosing scope without CPU time, for phases that
+/// are entered for every data block.
+#define SHIMEJIFINDER_TIME_BLOCKS(phase) \
+    ::shimejifinder::phase_timer SHIMEJIFINDER_STATS_CONCAT(phase_timer_, \
+        __LINE__) { phase, false }
+
+#define SHIMEJIFINDER_COUNT(counter, amount) ((counter) += (amount))
+#endif
@@ -18,9 +18,24 @@
 
 #include "utils.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/mman.h>
+#endif
 
 namespace shimejifinder {
 
+const std::vector<std::string> k_behaviors_names =
+    { "行動.xml", "behaviors.xml", "behavior.xml", "two.xml", "2.xml" };
+const std::vector<std::string> k_actions_names =
+    { "動作.xml", "actions.xml", "action.xml", "one.xml", "1.xml" };
+
 unsigned char asciitolower(unsigned char in) {
     if (in <= 'Z' && in >= 'A')
         return in - ('Z' - 'z');
@@ -57,4 +72,139 @@ std::string normalize_filename(std::string name) {
     return to_lower(name);
 }
 
+bool is_config_filename(std::string_view lower_name) {
+    return std::find(k_actions_names.begin(), k_actions_names.end(),
+            lower_name) != k_actions_names.end() ||
+        std::find(k_behaviors_names.begin(), k_behaviors_names.end(),
+            lower_name) != k_behaviors_names.end();
+}
+
+size_t default_thread_count() {
+    size_t threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+void parallel_for(size_t count, size_t threads,
+    std::function<void (size_t)> const& fn)
+{
+    if (threads == 0) {
+        threads = default_thread_count();
+    }
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        for (size_t i=0; i<count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // workers take the next unclaimed index until none are left, the
+    // first exception is rethrown once all workers are done
+    std::atomic<size_t> next { 0 };
+    std::exception_ptr error;
+    std::mutex error_lock;
+    auto worker = [&](){
+        size_t i;
+        while ((i = next++) < count) {
+            try {
+                fn(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock { error_lock };
+                if (error == nullptr) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i=1; i<threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+static int create_disk_spill_file(std::string const& dir) {
+    int fd = -1;
+    if (!dir.empty()) {
+        std::string path = dir + "/shimejifinder-XXXXXX";
+        fd = mkstemp(&path[0]);
+        if (fd != -1) {
+            // file is deleted once the descriptor is closed
+            unlink(path.c_str());
+        }
+    }
+    if (fd == -1) {
+        FILE *file = tmpfile();
+        if (file != nullptr) {
+            fd = dup(fileno(file));
+            fclose(file);
+        }
+    }
+    return fd;
+}
+
+int create_spill_file(std::string const& dir, bool *in_memory) {
+    if (in_memory != nullptr) {
+        *in_memory = false;
+    }
+    if (!dir.empty()) {
+        int fd = create_disk_spill_file(dir);
+        if (fd != -1) {
+            return fd;
+        }
+    }
+    #if defined(__linux__) && !defined(__ANDROID__)
+    int fd = memfd_create("shimejifinder", MFD_CLOEXEC);
+    if (fd != -1) {
+        if (in_memory != nullptr) {
+            *in_memory = true;
+        }
+        return fd;
+    }
+    #endif
+    return create_disk_spill_file("");
+}
+
+bool move_spill_file(int &fd, uint64_t size, std::string const& dir) {
+    int new_fd = create_disk_spill_file(dir);
+    if (new_fd == -1) {
+        return false;
+    }
+    std::vector<uint8_t> buf(std::min<uint64_t>(size, 1024 * 1024));
+    for (uint64_t offset = 0; offset < size; ) {
+        ssize_t ret = pread(fd, &buf[0], std::min<uint64_t>(buf.size(),
+            size - offset), (off_t)offset);
+        if (ret <= 0 || !write_spill_file(new_fd, offset, &buf[0], ret)) {
+            close(new_fd);
+            return false;
+        }
+        offset += ret;
+    }
+    close(fd);
+    fd = new_fd;
+    return true;
+}
+
+bool write_spill_file(int fd, uint64_t offset, const void *buf, size_t size) {
+    const char *data = (const char *)buf;
+    size_t written = 0;
+    while (written < size) {
+        ssize_t ret = pwrite(fd, data + written, size - written,
+            (off_t)(offset + written));
+        if (ret <= 0) {
+            return false;
+        }
+        written += ret;
+    }
+    return true;
+}
+
 }
@@ -18,14 +18,41 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 // 
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
 
 namespace shimejifinder {
 
+extern const std::vector<std::string> k_behaviors_names;
+extern const std::vector<std::string> k_actions_names;
+
 std::string to_lower(std::string data);
 unsigned char asciitolower(unsigned char in);
 std::string file_extension(std::string const& path);
 std::string last_component(std::string const& path);
 std::string normalize_filename(std::string name);
+bool is_config_filename(std::string_view lower_name);
+size_t default_thread_count();
+void parallel_for(size_t count, size_t threads,
+    std::function<void (size_t)> const& fn);
+
+/// Creates an anonymous temporary file in dir. If dir is empty or the file
+/// cannot be created there, an anonymous memory file is used where
+/// available, otherwise tmpfile(). Returns the file descriptor, or -1.
+/// If in_memory is given, it is set when a memory file is used.
+int create_spill_file(std::string const& dir, bool *in_memory = nullptr);
+
+/// Copies the first size bytes of a spill file to a new temporary file in
+/// dir, or tmpfile() if that fails, and replaces fd with it. Used to move
+/// memory files to disk once they grow too large. Returns false and keeps
+/// fd if the copy fails.
+bool move_spill_file(int &fd, uint64_t size, std::string const& dir);
+
+/// Writes size bytes at offset of a spill file. Returns false if not
+/// everything could be written.
+bool write_spill_file(int fd, uint64_t offset, const void *buf, size_t size);
 
 }
@@ -0,0 +1,169 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "write_pipeline.hpp"
+#include <cstring>
+
+namespace shimejifinder {
+
+write_pipeline::write_pipeline(extractor *extractor, archive_stats &stats,
+    size_t blocks): m_extractor(extractor), m_stats(stats),
+    m_ring(blocks < 2 ? 2 : blocks), m_read(0), m_written(0),
+    m_failed(false), m_aborted(false), m_sleeping(0)
+{
+    m_thread = std::thread { &write_pipeline::run, this };
+}
+
+write_pipeline::~write_pipeline() {
+    abort();
+}
+
+write_pipeline::command &write_pipeline::reserve() {
+    size_t written = m_written.load(std::memory_order_relaxed);
+    if (written - m_read.load(std::memory_order_acquire) == m_ring.size()) {
+        // backpressure, wait for the writer to catch up
+        std::unique_lock<std::mutex> lock { m_lock };
+        ++m_sleeping;
+        m_changed.wait(lock, [this, written]{
+            return m_failed || written - m_read.load() < m_ring.size();
+        });
+        --m_sleeping;
+    }
+    if (m_failed) {
+        join();
+        std::rethrow_exception(m_error);
+    }
+    return m_ring[written % m_ring.size()];
+}
+
+void write_pipeline::commit() {
+    m_written.fetch_add(1);
+    wake();
+}
+
+void write_pipeline::wake() {
+    // a thread registers as sleeping before it checks the ring for the
+    // last time, so either it sees the update or it is seen here
+    if (m_sleeping.load() > 0) {
+        {
+            std::lock_guard<std::mutex> lock { m_lock };
+        }
+        m_changed.notify_all();
+    }
+}
+
+void write_pipeline::begin_write(extract_target const& target) {
+    auto &cmd = reserve();
+    cmd.type = command::command_type::BEGIN;
+    cmd.target = target;
+    commit();
+}
+
+void write_pipeline::write_next(size_t offset, const void *buf, size_t size) {
+    auto &cmd = reserve();
+    cmd.type = command::command_type::DATA;
+    cmd.offset = offset;
+    cmd.size = size;
+    if (cmd.data.size() < size) {
+        cmd.data.resize(size);
+    }
+    memcpy(cmd.data.data(), buf, size);
+    commit();
+}
+
+void write_pipeline::end_write() {
+    reserve().type = command::command_type::END;
+    commit();
+}
+
+void write_pipeline::run() {
+    try {
+        while (!m_aborted) {
+            size_t read = m_read.load(std::memory_order_relaxed);
+            if (m_written.load(std::memory_order_acquire) == read) {
+                std::unique_lock<std::mutex> lock { m_lock };
+                ++m_sleeping;
+                m_changed.wait(lock, [this, read]{
+                    return m_aborted || m_written.load() != read;
+                });
+                --m_sleeping;
+                if (m_aborted) {
+                    return;
+                }
+            }
+            auto &cmd = m_ring[read % m_ring.size()];
+            bool finished = false;
+            {
+                SHIMEJIFINDER_TIME_BLOCKS(m_stats.writes);
+                switch (cmd.type) {
+                    case command::command_type::BEGIN:
+                        m_extractor->begin_write(cmd.target);
+                        break;
+                    case command::command_type::DATA:
+                        SHIMEJIFINDER_COUNT(m_stats.bytes_written, cmd.size);
+                        m_extractor->write_next(cmd.offset, cmd.data.data(),
+                            cmd.size);
+                        break;
+                    case command::command_type::END:
+                        m_extractor->end_write();
+                        break;
+                    case command::command_type::FINISH:
+                        finished = true;
+                        break;
+                }
+            }
+            m_read.fetch_add(1);
+            wake();
+            if (finished) {
+                return;
+            }
+        }
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock { m_lock };
+        m_error = std::current_exception();
+        m_failed = true;
+    }
+    m_changed.notify_all();
+}
+
+void write_pipeline::join() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void write_pipeline::finish() {
+    reserve().type = command::command_type::FINISH;
+    commit();
+    join();
+    if (m_failed) {
+        std::rethrow_exception(m_error);
+    }
+}
+
+void write_pipeline::abort() {
+    {
+        std::lock_guard<std::mutex> lock { m_lock };
+        m_aborted = true;
+    }
+    m_changed.notify_all();
+    join();
+}
+
+}
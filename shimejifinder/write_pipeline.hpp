@@ -0,0 +1,88 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "extract_target.hpp"
+#include "extractor.hpp"
+#include "stats.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace shimejifinder {
+
+/// Passes writes to an extractor on a separate thread, so that the thread
+/// reading the archive does not wait for the extractor and vice versa.
+/// Writes are queued in a bounded single-producer single-consumer ring of
+/// reusable buffers. The ring itself is lock-free; a mutex is only taken
+/// by a thread that has to sleep because the ring is full or empty, and by
+/// the other thread to wake it. Writes reach the extractor in the order
+/// they were queued.
+class write_pipeline {
+private:
+    struct command {
+        enum class command_type { BEGIN, DATA, END, FINISH } type;
+        extract_target target;
+        size_t offset;
+        size_t size;
+        std::vector<uint8_t> data;
+    };
+    extractor *m_extractor;
+    archive_stats &m_stats;
+    std::vector<command> m_ring;
+    std::atomic<size_t> m_read;
+    std::atomic<size_t> m_written;
+    std::atomic<bool> m_failed;
+    std::atomic<bool> m_aborted;
+    std::atomic<int> m_sleeping;
+    std::exception_ptr m_error;
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    std::thread m_thread;
+    command &reserve();
+    void commit();
+    void wake();
+    void run();
+    void join();
+public:
+    /// @param blocks Number of writes that may wait in the ring.
+    write_pipeline(extractor *extractor, archive_stats &stats,
+        size_t blocks);
+    write_pipeline(write_pipeline const&) = delete;
+    write_pipeline &operator=(write_pipeline const&) = delete;
+    ~write_pipeline();
+
+    // these may throw the exception thrown by the extractor on the writer
+    // thread
+    void begin_write(extract_target const& target);
+    void write_next(size_t offset, const void *buf, size_t size);
+    void end_write();
+
+    /// Waits until every queued write reached the extractor.
+    void finish();
+
+    /// Stops the writer thread, dropping queued writes.
+    void abort();
+};
+
+}
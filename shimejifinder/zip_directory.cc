@@ -0,0 +1,266 @@
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include "zip_directory.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace shimejifinder {
+
+static const uint32_t k_local_header = 0x04034b50;
+static const uint32_t k_central_header = 0x02014b50;
+static const uint32_t k_end_of_directory = 0x06054b50;
+static const uint32_t k_zip64_end_of_directory = 0x06064b50;
+static const uint32_t k_zip64_locator = 0x07064b50;
+static const size_t k_end_of_directory_size = 22;
+static const size_t k_zip64_locator_size = 20;
+static const size_t k_zip64_end_of_directory_size = 56;
+static const size_t k_central_header_size = 46;
+static const size_t k_max_comment = 0xFFFF;
+
+// the directory of a regular shimeji archive is a few hundred kilobytes,
+// anything larger than this is not worth reading into memory
+static const uint64_t k_max_directory_size = 256 * 1024 * 1024;
+
+static uint16_t get_u16(const uint8_t *buf) {
+    return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *buf) {
+    return (uint32_t)get_u16(buf) | ((uint32_t)get_u16(buf + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t *buf) {
+    return (uint64_t)get_u32(buf) | ((uint64_t)get_u32(buf + 4) << 32);
+}
+
+static bool read_at(input_source const& source, uint64_t offset, void *buf,
+    size_t size)
+{
+    auto out = (uint8_t *)buf;
+    while (size > 0) {
+        ssize_t ret = source.read(offset, out, size);
+        if (ret <= 0) {
+            return false;
+        }
+        out += ret;
+        offset += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+// replaces 0xFFFF... fields of a central directory entry with the values
+// of its zip64 extra field.
+static bool parse_extra(zip_directory::entry &entry,
+    const uint8_t *extra, size_t size)
+{
+    while (size >= 4) {
+        uint16_t id = get_u16(extra);
+        uint16_t field_size = get_u16(extra + 2);
+        if ((size_t)field_size + 4 > size) {
+            return false;
+        }
+        const uint8_t *field = extra + 4;
+        if (id == 0x0001) {
+            size_t left = field_size;
+            for (auto value : { &entry.size, &entry.compressed_size,
+                &entry.offset })
+            {
+                if (*value != 0xFFFFFFFF) {
+                    continue;
+                }
+                if (left < 8) {
+                    return false;
+                }
+                *value = get_u64(field);
+                field += 8;
+                left -= 8;
+            }
+        }
+        else if (id == 0x7075) {
+            entry.has_unicode_path = true;
+        }
+        extra += 4 + field_size;
+        size -= 4 + field_size;
+    }
+    return true;
+}
+
+zip_directory::zip_directory() {}
+
+bool zip_directory::read(int fd) {
+    clear();
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    input_source source { fd };
+    return read(source);
+}
+
+bool zip_directory::read(input_source const& source) {
+    clear();
+    if (!parse(source)) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+bool zip_directory::parse(input_source const& source) {
+    uint64_t file_size = source.size();
+    uint8_t header[4];
+    if (file_size < k_end_of_directory_size || !read_at(source, 0, header, 4) ||
+        get_u32(header) != k_local_header)
+    {
+        return false;
+    }
+
+    // the end of central directory record is followed by a comment of up
+    // to 64 KiB
+    size_t tail_size = (size_t)std::min<uint64_t>(file_size,
+        k_end_of_directory_size + k_max_comment);
+    uint64_t tail_offset = file_size - tail_size;
+    std::vector<uint8_t> tail(tail_size);
+    if (!read_at(source, tail_offset, &tail[0], tail_size)) {
+        return false;
+    }
+    size_t end_pos = tail_size - k_end_of_directory_size;
+    while (true) {
+        if (get_u32(&tail[end_pos]) == k_end_of_directory &&
+            end_pos + k_end_of_directory_size +
+            get_u16(&tail[end_pos + 20]) == tail_size)
+        {
+            break;
+        }
+        if (end_pos == 0) {
+            return false;
+        }
+        --end_pos;
+    }
+    const uint8_t *end = &tail[end_pos];
+    uint64_t end_offset = tail_offset + end_pos;
+    if (get_u16(end + 4) != get_u16(end + 6)) {
+        // split archives are not supported
+        return false;
+    }
+    uint64_t count = get_u16(end + 10);
+    uint64_t directory_size = get_u32(end + 12);
+    uint64_t directory_offset = get_u32(end + 16);
+    uint64_t directory_end = end_offset;
+
+    if (count == 0xFFFF || directory_size == 0xFFFFFFFF ||
+        directory_offset == 0xFFFFFFFF)
+    {
+        uint8_t locator[k_zip64_locator_size];
+        uint8_t end64[k_zip64_end_of_directory_size];
+        if (end_offset < k_zip64_locator_size ||
+            !read_at(source, end_offset - k_zip64_locator_size, locator,
+                sizeof(locator)) ||
+            get_u32(locator) != k_zip64_locator)
+        {
+            return false;
+        }
+        uint64_t end64_offset = get_u64(locator + 8);
+        if (end64_offset > end_offset - k_zip64_locator_size -
+                k_zip64_end_of_directory_size ||
+            !read_at(source, end64_offset, end64, sizeof(end64)) ||
+            get_u32(end64) != k_zip64_end_of_directory ||
+            get_u32(end64 + 16) != get_u32(end64 + 20))
+        {
+            return false;
+        }
+        count = get_u64(end64 + 32);
+        directory_size = get_u64(end64 + 40);
+        directory_offset = get_u64(end64 + 48);
+        directory_end = end64_offset;
+    }
+
+    // the directory has to end where the end record starts. offsets that
+    // are off by some amount, as in self-extracting archives or zip files
+    // appended to other data, are not supported
+    if (directory_size > directory_end ||
+        directory_size > k_max_directory_size ||
+        directory_offset != directory_end - directory_size ||
+        count > directory_size / k_central_header_size)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> directory(directory_size);
+    if (directory_size > 0 && !read_at(source, directory_offset,
+        &directory[0], directory_size))
+    {
+        return false;
+    }
+    m_entries.reserve(count);
+    size_t pos = 0;
+    for (uint64_t i=0; i<count; ++i) {
+        if (directory_size - pos < k_central_header_size) {
+            return false;
+        }
+        const uint8_t *record = &directory[pos];
+        if (get_u32(record) != k_central_header) {
+            return false;
+        }
+        size_t name_size = get_u16(record + 28);
+        size_t extra_size = get_u16(record + 30);
+        size_t comment_size = get_u16(record + 32);
+        size_t record_size = k_central_header_size + name_size +
+            extra_size + comment_size;
+        if (directory_size - pos < record_size) {
+            return false;
+        }
+        entry parsed;
+        parsed.version_made_by = get_u16(record + 4);
+        parsed.version_needed = get_u16(record + 6);
+        parsed.flags = get_u16(record + 8);
+        parsed.method = get_u16(record + 10);
+        parsed.compressed_size = get_u32(record + 20);
+        parsed.size = get_u32(record + 24);
+        parsed.external_attributes = get_u32(record + 38);
+        parsed.offset = get_u32(record + 42);
+        parsed.has_unicode_path = false;
+        parsed.name.assign((const char *)record + k_central_header_size,
+            name_size);
+        if (!parse_extra(parsed, record + k_central_header_size +
+            name_size, extra_size))
+        {
+            return false;
+        }
+        if (parsed.offset >= directory_offset) {
+            return false;
+        }
+        m_entries.push_back(std::move(parsed));
+        pos += record_size;
+    }
+    return true;
+}
+
+std::vector<zip_directory::entry> const& zip_directory::entries() const {
+    return m_entries;
+}
+
+void zip_directory::clear() {
+    m_entries.clear();
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// 
+// libshimejifinder - library for finding and extracting shimeji from archives
+// Copyright (C) 2025 pixelomer
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "input_source.hpp"
+
+namespace shimejifinder {
+
+/// Central directory of a zip file, read without going through the
+/// entries themselves.
+class zip_directory {
+public:
+    struct entry {
+        /// Name as stored in the archive, not converted.
+        std::string name;
+        /// Position of the local file header in the file.
+        uint64_t offset;
+        uint64_t compressed_size;
+        uint64_t size;
+        uint32_t external_attributes;
+        uint16_t version_made_by;
+        uint16_t version_needed;
+        uint16_t flags;
+        uint16_t method;
+        /// The entry has an Info-ZIP unicode path extra field, which
+        /// replaces name.
+        bool has_unicode_path;
+    };
+private:
+    std::vector<entry> m_entries;
+    bool parse(input_source const& source);
+public:
+    zip_directory();
+
+    /// Reads the central directory of the zip file open at fd. The file
+    /// position of fd is not changed. Returns false if the file is not a
+    /// zip file or its directory is damaged, leaving the directory empty.
+    /// Zip files with data before their first entry, such as
+    /// self-extracting archives, are rejected.
+    bool read(int fd);
+
+    /// Reads the central directory of the zip file in source.
+    bool read(input_source const& source);
+
+    /// Entries in the order of the central directory.
+    std::vector<entry> const& entries() const;
+    void clear();
+};
+
+}
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building actions.xml scanner tests..."
+echo
+
+pushd tests/actions_scanner 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing actions.xml scanner"
+echo
+tests/actions_scanner/build/actions_scanner_test
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building entry table tests..."
+echo
+
+pushd tests/entry_table 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing entry table"
+echo
+tests/entry_table/build/entry_table_test
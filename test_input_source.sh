@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building input source tests..."
+echo
+
+pushd tests/input_source 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing input source"
+echo
+tests/input_source/build/input_source_test
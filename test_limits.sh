@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building limits tests..."
+echo
+
+pushd tests/limits 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing resource limits"
+echo
+tests/limits/build/limits_test
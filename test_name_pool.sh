@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building name pool tests..."
+echo
+
+pushd tests/name_pool 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing name pool"
+echo
+tests/name_pool/build/name_pool_test
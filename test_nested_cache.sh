@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building nested cache tests..."
+echo
+
+pushd tests/nested_cache 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing nested cache"
+echo
+tests/nested_cache/build/nested_cache_test
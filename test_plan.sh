@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building plan tests..."
+echo
+
+pushd tests/plan 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing plan serialization"
+echo
+tests/plan/build/plan_test
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building write pipeline tests..."
+echo
+
+pushd tests/write_pipeline 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing write pipeline"
+echo
+tests/write_pipeline/build/write_pipeline_test
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+echo "==> Building zip directory tests..."
+echo
+
+pushd tests/zip_directory 2>/dev/null >&2
+(cmake -Bbuild && make -Cbuild -j"$(nproc)") 2>/dev/null >&2 || { echo "Build failed."; exit 1; }
+popd 2>/dev/null >&2
+
+echo "==> Testing zip directory"
+echo
+tests/zip_directory/build/zip_directory_test
@@ -0,0 +1,93 @@
+#include <shimejifinder/actions_scanner.hpp>
+#include <gtest/gtest.h>
+
+using shimejifinder::scan_actions_xml;
+
+static std::set<std::string> scan(std::string const& xml) {
+    std::set<std::string> paths;
+    EXPECT_TRUE(scan_actions_xml(xml, paths));
+    return paths;
+}
+
+TEST(ActionsScanner, CollectsPoseAttributes) {
+    auto paths = scan(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<Mascot xmlns=\"http://www.group-finity.com/Mascot\">\n"
+        "  <ActionList>\n"
+        "    <Action Name=\"Walk\" Type=\"Move\">\n"
+        "      <Animation>\n"
+        "        <Pose Image=\"/Shime1.png\" ImageRight=\"/shime1r.png\"\n"
+        "          ImageAnchor=\"64,128\" Duration=\"6\" />\n"
+        "        <Pose Image='/shime2.png' Sound=\"/Sound/a.WAV\"></Pose>\n"
+        "      </Animation>\n"
+        "    </Action>\n"
+        "  </ActionList>\n"
+        "</Mascot>\n");
+    EXPECT_EQ(paths, (std::set<std::string> { "/shime1.png", "/shime1r.png",
+        "/shime2.png", "/sound/a.wav" }));
+}
+
+TEST(ActionsScanner, JapaneseNames) {
+    auto paths = scan(
+        "<マスコット><動作リスト><動作><アニメーション>"
+        "<ポーズ 画像=\"/shime1.png\" 基準座標=\"64,128\"/>"
+        "</アニメーション></動作></動作リスト></マスコット>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/shime1.png" }));
+}
+
+TEST(ActionsScanner, PrefersMascotRoot) {
+    auto paths = scan(
+        "<マスコット><ポーズ 画像=\"/a.png\"/></マスコット>"
+        "<Mascot><Pose Image=\"/b.png\"/></Mascot>"
+        "<Mascot><Pose Image=\"/c.png\"/></Mascot>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/b.png" }));
+}
+
+TEST(ActionsScanner, DecodesAttributes) {
+    auto paths = scan(
+        "<Mascot><Pose Image=\"/a&amp;b&#x41;&#66;.png\" "
+        "Sound=\"/x&unknown;\ty.wav\" ImageRight=\"/r\r\n.png\"/></Mascot>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/a&bab.png",
+        "/x&unknown; y.wav", "/r .png" }));
+}
+
+TEST(ActionsScanner, SkipsMarkup) {
+    auto paths = scan(
+        "<!DOCTYPE Mascot [ <!ENTITY x \"<Pose Image='/no1.png'/>\"> ]>"
+        "<Mascot><!-- <Pose Image=\"/no2.png\"/> -->"
+        "<![CDATA[ <Pose Image=\"/no3.png\"/> ]]>"
+        "<?pi <Pose Image=\"/no4.png\"/> ?>"
+        "<Pose Image=\"/yes.png\"/></Mascot>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/yes.png" }));
+}
+
+TEST(ActionsScanner, IgnoresNestedPosesAndOtherElements) {
+    auto paths = scan(
+        "<Mascot><Pose Image=\"/outer.png\" Image=\"/duplicate.png\">"
+        "<Pose Image=\"/inner.png\"/></Pose>"
+        "<Other Image=\"/other.png\"/></Mascot>"
+        "<Pose Image=\"/outside.png\"/>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/outer.png" }));
+}
+
+TEST(ActionsScanner, KeepsPathsBeforeError) {
+    auto paths = scan(
+        "<Mascot><Pose Image=\"/a.png\"/><Broken></Mismatch>"
+        "<Pose Image=\"/b.png\"/></Mascot>");
+    EXPECT_EQ(paths, (std::set<std::string> { "/a.png" }));
+}
+
+TEST(ActionsScanner, RejectsOtherFiles) {
+    std::set<std::string> paths;
+    EXPECT_FALSE(scan_actions_xml("<BehaviorList><Pose Image=\"/a.png\"/>"
+        "</BehaviorList>", paths));
+    EXPECT_FALSE(scan_actions_xml("", paths));
+    EXPECT_FALSE(scan_actions_xml("not xml", paths));
+    EXPECT_TRUE(paths.empty());
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
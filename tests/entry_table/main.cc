@@ -0,0 +1,115 @@
+#include <shimejifinder/entry_table.hpp>
+#include <shimejifinder/extract_plan.hpp>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using shimejifinder::entry_table;
+using shimejifinder::extract_target;
+
+TEST(EntryTableTest, StoresPathAndLowerName) {
+    entry_table table;
+    auto entry = table.add(4, "Pack/IMG/Shime1.PNG");
+    EXPECT_TRUE(entry->valid());
+    EXPECT_EQ(entry->index(), 4);
+    EXPECT_EQ(entry->path(), "Pack/IMG/Shime1.PNG");
+    EXPECT_EQ(entry->lower_name(), "shime1.png");
+    EXPECT_EQ(entry->lower_extension(), "png");
+    EXPECT_EQ(entry->dirname(), "Pack/IMG");
+    EXPECT_EQ(entry->type(), extract_target::extract_type::IMAGE);
+}
+
+TEST(EntryTableTest, DetectsType) {
+    entry_table table;
+    EXPECT_EQ(table.add(0, "a/b.wav")->type(), extract_target::extract_type::SOUND);
+    EXPECT_EQ(table.add(1, "a/b.Xml")->type(), extract_target::extract_type::XML);
+    EXPECT_EQ(table.add(2, "a/b.txt")->type(), extract_target::extract_type::UNSPECIFIED);
+    EXPECT_EQ(table.add(3, "a.png/b")->type(), extract_target::extract_type::UNSPECIFIED);
+    EXPECT_EQ(table.add(4, "png")->lower_extension(), "");
+}
+
+TEST(EntryTableTest, MovesConfigurationIntoImageFolder) {
+    entry_table table;
+    EXPECT_EQ(table.add(0, "pack/conf/Name/actions.xml")->path(),
+        "pack/img/Name/actions.xml");
+    EXPECT_EQ(table.add(1, "conf/Name/behaviors.xml")->path(),
+        "img/Name/behaviors.xml");
+    EXPECT_EQ(table.add(2, "pack/conf/actions.xml")->path(),
+        "pack/conf/actions.xml");
+    EXPECT_EQ(table.add(3, "pack/conf/Name/shime1.png")->path(),
+        "pack/conf/Name/shime1.png");
+}
+
+TEST(EntryTableTest, PointersStayValid) {
+    entry_table table;
+    std::vector<shimejifinder::archive_entry *> entries;
+    std::string long_name(100000, 'a');
+    for (int i=0; i<5000; ++i) {
+        auto path = "dir" + std::to_string(i) + "/" +
+            (i % 1000 == 0 ? long_name : "") + "shime.png";
+        entries.push_back(table.add(i, path));
+    }
+    ASSERT_EQ(table.size(), 5000U);
+    for (int i=0; i<5000; ++i) {
+        EXPECT_EQ(table[i], entries[i]);
+        EXPECT_EQ(entries[i]->index(), i);
+        auto path = "dir" + std::to_string(i) + "/" +
+            (i % 1000 == 0 ? long_name : "") + "shime.png";
+        EXPECT_EQ(entries[i]->path(), path);
+    }
+}
+
+TEST(EntryTableTest, Truncate) {
+    entry_table table;
+    shimejifinder::name_pool names;
+    table.add(0, "a.png");
+    auto entry = table.add(1, "b.png");
+    entry->add_target({ names, "A", "b.png", extract_target::extract_type::IMAGE });
+    table.truncate(1);
+    EXPECT_EQ(table.size(), 1U);
+    EXPECT_EQ(table[0]->path(), "a.png");
+    entry = table.add(2, "c.png");
+    EXPECT_EQ(entry->path(), "c.png");
+    EXPECT_TRUE(entry->extract_targets().empty());
+    table.clear();
+    EXPECT_EQ(table.size(), 0U);
+}
+
+TEST(EntryTableTest, ExtractPlan) {
+    entry_table table;
+    shimejifinder::name_pool names;
+    table.add(0, "a/actions.xml")->add_target({ names, "A", "actions.xml",
+        extract_target::extract_type::XML });
+    table.add(1, "a/readme.xml");
+    table.add(3, "a/shime1.png")->add_target({ names, "A", "shime1.png",
+        extract_target::extract_type::IMAGE });
+    table.add(7, "a/a.wav")->add_target({ names, "A", "a.wav",
+        extract_target::extract_type::SOUND });
+    table.add(9, "a/b.wav");
+
+    shimejifinder::extract_plan plan;
+    plan.build(table);
+    ASSERT_EQ(plan.size(), 3U);
+    EXPECT_FALSE(plan.done());
+    EXPECT_EQ(plan.take(0), table[0]);
+    EXPECT_EQ(plan.take(1), nullptr);
+    EXPECT_EQ(plan.take(2), nullptr);
+    EXPECT_EQ(plan.take(3), table[2]);
+    EXPECT_FALSE(plan.done());
+
+    // passing a needed index without taking it skips it
+    EXPECT_EQ(plan.take(8), nullptr);
+    EXPECT_TRUE(plan.done());
+    EXPECT_EQ(plan.take(9), nullptr);
+
+    table.clear();
+    plan.build(table);
+    EXPECT_EQ(plan.size(), 0U);
+    EXPECT_TRUE(plan.done());
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
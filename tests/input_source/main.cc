@@ -0,0 +1,135 @@
+#include <shimejifinder/input_source.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+using shimejifinder::input_source;
+
+static FILE *make_file(std::string const& data) {
+    FILE *file = tmpfile();
+    fwrite(data.data(), 1, data.size(), file);
+    fflush(file);
+    return file;
+}
+
+static std::string make_data(size_t size) {
+    std::string data;
+    for (size_t i=0; i<size; ++i) {
+        data += (char)(i * 7 + i / 251);
+    }
+    return data;
+}
+
+static std::string read_all(input_source const& source, size_t block) {
+    std::string out;
+    std::vector<char> buf(block);
+    while (true) {
+        ssize_t ret = source.read(out.size(), &buf[0], buf.size());
+        if (ret <= 0) {
+            EXPECT_EQ(ret, 0);
+            return out;
+        }
+        out.append(&buf[0], ret);
+    }
+}
+
+TEST(InputSourceTest, MappedAndUnmappedReadsMatch) {
+    auto data = make_data(100000);
+    FILE *file = make_file(data);
+    input_source unmapped { fileno(file) };
+    input_source mapped;
+    ASSERT_TRUE(mapped.map(fileno(file)));
+    fclose(file);
+
+    // the mapping stays valid after the file is closed
+    EXPECT_TRUE(mapped.in_memory());
+    EXPECT_EQ(mapped.size(), data.size());
+    EXPECT_EQ(std::string((const char *)mapped.data(), mapped.size()), data);
+    EXPECT_EQ(read_all(mapped, 4096), data);
+    EXPECT_EQ(read_all(mapped, 1 << 20), data);
+
+    char c;
+    EXPECT_EQ(mapped.read(data.size(), &c, 1), 0);
+    EXPECT_EQ(mapped.read(data.size() + 100, &c, 1), 0);
+    EXPECT_FALSE(unmapped.in_memory());
+    EXPECT_EQ(unmapped.data(), nullptr);
+}
+
+TEST(InputSourceTest, ReadsWithPread) {
+    auto data = make_data(10000);
+    FILE *file = make_file(data);
+    input_source source { fileno(file) };
+    EXPECT_TRUE(source.is_open());
+    EXPECT_EQ(source.size(), data.size());
+    EXPECT_EQ(read_all(source, 1000), data);
+    fclose(file);
+}
+
+TEST(InputSourceTest, ReadsFromBuffer) {
+    auto data = make_data(5000);
+    input_source source;
+    source.open(data.data(), data.size());
+    EXPECT_TRUE(source.in_memory());
+    EXPECT_EQ((const void *)source.data(), (const void *)data.data());
+    EXPECT_EQ(read_all(source, 777), data);
+
+    // the buffer belongs to the caller
+    source.close();
+    EXPECT_FALSE(source.is_open());
+    EXPECT_EQ(data, make_data(5000));
+
+    source.open(nullptr, 100);
+    EXPECT_TRUE(source.in_memory());
+    EXPECT_EQ(source.size(), 0U);
+}
+
+TEST(InputSourceTest, RejectsPipesAndEmptyFiles) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    input_source source;
+    EXPECT_FALSE(source.map(fds[0]));
+    EXPECT_FALSE(source.is_open());
+    close(fds[0]);
+    close(fds[1]);
+
+    FILE *file = make_file("");
+    EXPECT_FALSE(source.map(fileno(file)));
+    fclose(file);
+}
+
+TEST(InputSourceTest, ConcurrentReads) {
+    auto data = make_data(1 << 20);
+    FILE *file = make_file(data);
+    for (bool map : { false, true }) {
+        input_source source;
+        if (map) {
+            ASSERT_TRUE(source.map(fileno(file)));
+        }
+        else {
+            source.open(fileno(file));
+        }
+        std::vector<std::string> results(4);
+        std::vector<std::thread> threads;
+        for (size_t i=0; i<results.size(); ++i) {
+            threads.emplace_back([&, i](){
+                results[i] = read_all(source, 1000 + i * 333);
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (auto &result : results) {
+            EXPECT_EQ(result, data);
+        }
+    }
+    fclose(file);
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+#include <shimejifinder/resource_guard.hpp>
+#include <gtest/gtest.h>
+#include <functional>
+#include <thread>
+
+using shimejifinder::analyze_config;
+using shimejifinder::limit_exceeded;
+using shimejifinder::resource_guard;
+
+static limit_exceeded::limit_type thrown_type(std::function<void ()> fn) {
+    try {
+        fn();
+    }
+    catch (limit_exceeded &ex) {
+        return ex.type();
+    }
+    ADD_FAILURE() << "limit_exceeded was not thrown";
+    return limit_exceeded::limit_type::ENTRIES;
+}
+
+TEST(ResourceGuard, Entries) {
+    analyze_config config;
+    config.max_entries = 3;
+    resource_guard guard;
+    guard.reset(config);
+    guard.add_entry();
+    guard.add_entry();
+    guard.add_entry();
+    EXPECT_EQ(thrown_type([&]{ guard.add_entry(); }),
+        limit_exceeded::limit_type::ENTRIES);
+
+    // reset() starts counting again
+    guard.reset(config);
+    EXPECT_NO_THROW(guard.add_entry());
+}
+
+TEST(ResourceGuard, TotalBytes) {
+    analyze_config config;
+    config.max_total_bytes = 1000;
+    resource_guard guard;
+    guard.reset(config);
+    guard.add_bytes(600);
+    guard.add_bytes(400);
+    EXPECT_EQ(thrown_type([&]{ guard.add_bytes(1); }),
+        limit_exceeded::limit_type::TOTAL_BYTES);
+}
+
+TEST(ResourceGuard, CompressionRatio) {
+    analyze_config config;
+    config.max_compression_ratio = 10;
+    resource_guard guard;
+    guard.reset(config);
+
+    // small entries are never rejected, even without any compressed input
+    EXPECT_NO_THROW(guard.check_ratio(1024 * 1024, 0));
+    EXPECT_NO_THROW(guard.check_ratio(100 * 1024 * 1024, 10 * 1024 * 1024));
+    EXPECT_EQ(thrown_type([&]{
+        guard.check_ratio(100 * 1024 * 1024, 1024 * 1024);
+    }), limit_exceeded::limit_type::COMPRESSION_RATIO);
+}
+
+TEST(ResourceGuard, NestingDepth) {
+    analyze_config config;
+    config.max_nesting_depth = 2;
+    resource_guard guard;
+    guard.reset(config);
+    guard.enter_nested();
+    guard.enter_nested();
+    EXPECT_EQ(thrown_type([&]{ guard.enter_nested(); }),
+        limit_exceeded::limit_type::NESTING_DEPTH);
+    guard.leave_nested();
+    EXPECT_NO_THROW(guard.enter_nested());
+}
+
+TEST(ResourceGuard, WallTime) {
+    analyze_config config;
+    config.max_wall_time_ms = 1;
+    resource_guard guard;
+    guard.reset(config);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(thrown_type([&]{ guard.add_entry(); }),
+        limit_exceeded::limit_type::WALL_TIME);
+}
+
+TEST(ResourceGuard, ZeroDisablesLimits) {
+    analyze_config config;
+    config.max_entries = 0;
+    config.max_total_bytes = 0;
+    config.max_compression_ratio = 0;
+    config.max_nesting_depth = 0;
+    config.max_wall_time_ms = 0;
+    resource_guard guard;
+    guard.reset(config);
+    for (int i=0; i<1000; ++i) {
+        guard.add_entry();
+        guard.enter_nested();
+    }
+    EXPECT_NO_THROW(guard.add_bytes(UINT64_MAX / 2));
+    EXPECT_NO_THROW(guard.check_ratio(UINT64_MAX / 2, 0));
+}
+
+TEST(ResourceGuard, Cancellation) {
+    analyze_config config;
+    config.cancellation = std::make_shared<shimejifinder::cancellation_token>();
+    resource_guard guard;
+    guard.reset(config);
+    guard.add_entry();
+    guard.add_bytes(100);
+    config.cancellation->cancel();
+    EXPECT_THROW(guard.add_entry(), shimejifinder::operation_cancelled);
+    EXPECT_THROW(guard.add_bytes(100), shimejifinder::read_aborted);
+    EXPECT_THROW(guard.check_cancelled(), shimejifinder::operation_cancelled);
+}
+
+TEST(ResourceGuard, PendingIsRethrownOnce) {
+    analyze_config config;
+    config.max_entries = 1;
+    resource_guard guard;
+    guard.reset(config);
+    guard.add_entry();
+    try {
+        guard.add_entry();
+    }
+    catch (limit_exceeded &) {
+        guard.set_pending();
+    }
+    EXPECT_EQ(thrown_type([&]{ guard.rethrow_pending(); }),
+        limit_exceeded::limit_type::ENTRIES);
+    EXPECT_NO_THROW(guard.rethrow_pending());
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
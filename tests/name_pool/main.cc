@@ -0,0 +1,76 @@
+#include <shimejifinder/name_pool.hpp>
+#include <shimejifinder/extract_target.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+
+using shimejifinder::extract_target;
+using shimejifinder::name_pool;
+
+TEST(NamePoolTest, InternsOnce) {
+    name_pool names;
+    auto a = names.intern("actions.xml");
+    std::string other = "actions";
+    other += ".xml";
+    EXPECT_EQ(names.intern(other), a);
+    EXPECT_NE(names.intern("behaviors.xml"), a);
+    EXPECT_EQ(*a, "actions.xml");
+    EXPECT_EQ(names.size(), 2U);
+}
+
+TEST(NamePoolTest, EmptyName) {
+    name_pool names;
+    EXPECT_EQ(names.intern(""), name_pool::empty());
+    EXPECT_EQ(names.size(), 0U);
+    extract_target target;
+    EXPECT_EQ(target.shimeji_name(), "");
+    EXPECT_EQ(target.extract_name(), "");
+}
+
+TEST(NamePoolTest, StableAcrossGrowth) {
+    name_pool names;
+    auto first = names.intern("shime1.png");
+    for (int i=2; i<=10000; ++i) {
+        names.intern("shime" + std::to_string(i) + ".png");
+    }
+    EXPECT_EQ(names.intern("shime1.png"), first);
+    EXPECT_EQ(*first, "shime1.png");
+}
+
+TEST(NamePoolTest, Concurrent) {
+    name_pool names;
+    std::vector<std::thread> threads;
+    std::vector<const std::string *> results(8);
+    for (size_t i=0; i<results.size(); ++i) {
+        threads.emplace_back([&names, &results, i]{
+            for (int j=0; j<1000; ++j) {
+                names.intern("img/" + std::to_string(j) + ".png");
+            }
+            results[i] = names.intern("img/500.png");
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(names.size(), 1000U);
+    for (auto result : results) {
+        EXPECT_EQ(result, results[0]);
+    }
+}
+
+TEST(NamePoolTest, TargetsShareNames) {
+    name_pool names;
+    extract_target a { names, "A", "shime1.png",
+        extract_target::extract_type::IMAGE };
+    extract_target b { names, "B", "shime1.png",
+        extract_target::extract_type::IMAGE };
+    EXPECT_EQ(&a.extract_name(), &b.extract_name());
+    EXPECT_EQ(a.shimeji_name(), "A");
+    EXPECT_EQ(b.shimeji_name(), "B");
+    EXPECT_EQ(a.type(), extract_target::extract_type::IMAGE);
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,101 @@
+#include <shimejifinder/nested_cache.hpp>
+#include <shimejifinder/utils.hpp>
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using shimejifinder::nested_cache;
+
+static int make_copy(std::string const& data) {
+    int fd = shimejifinder::create_spill_file("");
+    EXPECT_NE(fd, -1);
+    EXPECT_TRUE(shimejifinder::write_spill_file(fd, 0, data.data(),
+        data.size()));
+    return fd;
+}
+
+static bool is_open(int fd) {
+    return fcntl(fd, F_GETFD) != -1;
+}
+
+TEST(NestedCache, FindsInsertedArchives) {
+    nested_cache cache;
+    int fd = make_copy("nested archive");
+    cache.add(3, "pack/inner.zip");
+    ASSERT_TRUE(cache.insert(3, "pack/inner.zip", fd, 14, 1024));
+    uint64_t size = 0;
+
+    // copies are only used once the first pass is over
+    EXPECT_EQ(cache.find(3, "pack/inner.zip", size), -1);
+    cache.complete();
+    EXPECT_EQ(cache.find(3, "pack/inner.zip", size), fd);
+    EXPECT_EQ(size, 14U);
+    EXPECT_EQ(cache.find(3, "pack/other.zip", size), -1);
+    EXPECT_EQ(cache.find(4, "pack/inner.zip", size), -1);
+    EXPECT_EQ(cache.size(), 14U);
+
+    char buf[6] = {};
+    ASSERT_EQ(pread(fd, buf, 6, 0), 6);
+    EXPECT_EQ(std::string(buf, 6), "nested");
+}
+
+TEST(NestedCache, RespectsLimit) {
+    nested_cache cache;
+    int first = make_copy(std::string(600, 'a'));
+    int second = make_copy(std::string(600, 'b'));
+    cache.add(0, "a.zip");
+    cache.add(1, "b.zip");
+    EXPECT_TRUE(cache.insert(0, "a.zip", first, 600, 1000));
+
+    // the caller keeps archives that are not cached
+    EXPECT_FALSE(cache.insert(1, "b.zip", second, 600, 1000));
+    EXPECT_TRUE(is_open(second));
+    EXPECT_FALSE(cache.insert(0, "a.zip", second, 1, 1000));
+    EXPECT_FALSE(cache.insert(2, "c.zip", second, 1, 1000));
+    close(second);
+
+    cache.complete();
+    uint64_t size;
+    EXPECT_EQ(cache.find(1, "b.zip", size), -1);
+    EXPECT_EQ(cache.size(), 600U);
+}
+
+TEST(NestedCache, SkipsDuplicateArchives) {
+    nested_cache cache;
+    int first = make_copy("first");
+    int second = make_copy("second");
+
+    // two empty nested archives with the same path start at the same
+    // index, neither copy can be told apart from the other
+    cache.add(5, "pack/a.zip");
+    ASSERT_TRUE(cache.insert(5, "pack/a.zip", first, 5, 1024));
+    cache.add(5, "pack/a.zip");
+    EXPECT_FALSE(is_open(first));
+    EXPECT_EQ(cache.size(), 0U);
+    EXPECT_FALSE(cache.insert(5, "pack/a.zip", second, 6, 1024));
+    EXPECT_TRUE(is_open(second));
+    close(second);
+
+    cache.complete();
+    uint64_t size;
+    EXPECT_EQ(cache.find(5, "pack/a.zip", size), -1);
+}
+
+TEST(NestedCache, ClearClosesCopies) {
+    nested_cache cache;
+    int fd = make_copy("data");
+    cache.add(0, "a.7z");
+    ASSERT_TRUE(cache.insert(0, "a.7z", fd, 4, 1024));
+    cache.complete();
+    cache.clear();
+    EXPECT_FALSE(is_open(fd));
+    EXPECT_EQ(cache.size(), 0U);
+    uint64_t size;
+    EXPECT_EQ(cache.find(0, "a.7z", size), -1);
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
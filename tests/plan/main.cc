@@ -0,0 +1,148 @@
+#include <shimejifinder/analyze.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+
+using shimejifinder::extract_target;
+
+// exposes add_entry() so that plans can be built without an archive. any
+// file is listed as the same entries, modified at mtime
+class test_archive : public shimejifinder::archive {
+private:
+    const char *m_backend;
+    int64_t m_mtime;
+protected:
+    void fill_entries() override {
+        add_fingerprint("pack/conf/actions.xml", 100, m_mtime);
+        add_fingerprint("pack/readme.xml", 20, m_mtime);
+        add_fingerprint("pack/img/A/shime1.png", 300, m_mtime);
+        add_fingerprint("pack/sound/a.wav", 400, m_mtime);
+    }
+public:
+    using shimejifinder::archive::add_entry;
+    test_archive(const char *backend = "test", int64_t mtime = 0):
+        m_backend(backend), m_mtime(mtime) {}
+    const char *backend_name() const override { return m_backend; }
+};
+
+static std::string make_file(std::string const& name, size_t size) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    FILE *file = fopen(path.c_str(), "wb");
+    std::string data(size, 'a');
+    fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    return path;
+}
+
+static std::string archive_path() {
+    static std::string path = make_file("shimejifinder-plan-test.zip", 64);
+    return path;
+}
+
+static void fill(test_archive &ar) {
+    ar.open(archive_path());
+    auto actions = ar.add_entry(0, "pack/conf/actions.xml");
+    actions->add_target({ ar.names(), "A", "actions.xml", extract_target::extract_type::XML });
+    actions->add_target({ ar.names(), "B", "actions.xml", extract_target::extract_type::XML });
+    ar.add_entry(1, "pack/readme.xml");
+    auto image = ar.add_entry(3, "pack/img/A/shime1.png");
+    image->add_target({ ar.names(), "A", "shime1.png", extract_target::extract_type::IMAGE });
+    auto sound = ar.add_entry(7, "pack/sound/a.wav");
+    sound->add_target({ ar.names(), "B", "a.wav", extract_target::extract_type::SOUND });
+    ar.add_default_xml_targets("C");
+    ar.add_shimeji("A");
+    ar.add_shimeji("B");
+    ar.add_shimeji("C");
+}
+
+static std::string save(test_archive const& ar) {
+    std::ostringstream out;
+    ar.save_plan(out);
+    return out.str();
+}
+
+TEST(PlanTest, RoundTrip) {
+    test_archive original;
+    fill(original);
+    std::istringstream in { save(original) };
+    test_archive loaded;
+    ASSERT_TRUE(loaded.load_plan(in, archive_path()));
+
+    // entries without targets are not part of the plan
+    ASSERT_EQ(loaded.size(), 3U);
+    std::vector<int> expected_indices = { 0, 3, 7 };
+    for (size_t i=0, j=0; i<original.size(); ++i) {
+        auto expected = original[i];
+        if (expected->extract_targets().empty()) {
+            continue;
+        }
+        auto actual = loaded[j++];
+        EXPECT_EQ(actual->index(), expected->index());
+        EXPECT_EQ(actual->path(), expected->path());
+        auto &expected_targets = expected->extract_targets();
+        auto &actual_targets = actual->extract_targets();
+        ASSERT_EQ(actual_targets.size(), expected_targets.size());
+        for (size_t k=0; k<actual_targets.size(); ++k) {
+            EXPECT_EQ(actual_targets[k].shimeji_name(), expected_targets[k].shimeji_name());
+            EXPECT_EQ(actual_targets[k].extract_name(), expected_targets[k].extract_name());
+            EXPECT_EQ(actual_targets[k].type(), expected_targets[k].type());
+        }
+    }
+    EXPECT_EQ(loaded.default_xml_targets(), original.default_xml_targets());
+    EXPECT_EQ(loaded.shimejis(), original.shimejis());
+
+    // saving a loaded plan produces the same plan
+    EXPECT_EQ(save(loaded), save(original));
+}
+
+TEST(PlanTest, RejectTruncatedPlan) {
+    test_archive original;
+    fill(original);
+    auto plan = save(original);
+    for (size_t size=0; size<plan.size(); ++size) {
+        std::istringstream in { plan.substr(0, size) };
+        test_archive loaded;
+        EXPECT_FALSE(loaded.load_plan(in, archive_path())) <<
+            "Expected plan truncated to " << size << " bytes to be rejected";
+    }
+}
+
+TEST(PlanTest, RejectOtherBackend) {
+    test_archive original;
+    fill(original);
+    std::istringstream in { save(original) };
+    test_archive loaded { "other" };
+    EXPECT_FALSE(loaded.load_plan(in, archive_path()));
+}
+
+TEST(PlanTest, RejectOtherArchive) {
+    test_archive original;
+    fill(original);
+    auto plan = save(original);
+
+    // same file, listed with different entries
+    std::istringstream in { plan };
+    test_archive modified { "test", 1 };
+    EXPECT_FALSE(modified.load_plan(in, archive_path()));
+
+    // same entries in a file of another size
+    in = std::istringstream { plan };
+    test_archive other;
+    EXPECT_FALSE(other.load_plan(in,
+        make_file("shimejifinder-plan-test-other.zip", 65)));
+}
+
+TEST(PlanTest, LoadPlanThrowsForUnknownBackend) {
+    test_archive original;
+    fill(original);
+    std::istringstream in { save(original) };
+    EXPECT_THROW(shimejifinder::load_plan(in, archive_path()),
+        std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,95 @@
+#include <shimejifinder/write_pipeline.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using shimejifinder::extract_target;
+using shimejifinder::write_pipeline;
+
+// records every call as a string
+class recording_extractor : public shimejifinder::extractor {
+public:
+    std::vector<std::string> calls;
+    size_t fail_after = SIZE_MAX;
+    void begin_write(extract_target const& target) override {
+        calls.push_back("begin " + target.extract_name());
+    }
+    void write_next(size_t offset, const void *buf, size_t size) override {
+        if (calls.size() >= fail_after) {
+            throw std::runtime_error("disk full");
+        }
+        calls.push_back("write " + std::to_string(offset) + " " +
+            std::string((const char *)buf, size));
+    }
+    void end_write() override {
+        calls.push_back("end");
+    }
+};
+
+static std::vector<std::string> write_files(write_pipeline &pipeline,
+    shimejifinder::name_pool &names, size_t count)
+{
+    std::vector<std::string> expected;
+    for (size_t i=0; i<count; ++i) {
+        auto name = std::to_string(i) + ".png";
+        pipeline.begin_write({ names, "A", name,
+            extract_target::extract_type::IMAGE });
+        expected.push_back("begin " + name);
+        for (size_t j=0; j<3; ++j) {
+            // the buffer is reused right away, as backends do
+            std::string data = name + "/" + std::to_string(j);
+            pipeline.write_next(j * 100, data.data(), data.size());
+            data.assign(data.size(), 'x');
+            expected.push_back("write " + std::to_string(j * 100) + " " +
+                name + "/" + std::to_string(j));
+        }
+        pipeline.end_write();
+        expected.push_back("end");
+    }
+    return expected;
+}
+
+TEST(WritePipelineTest, KeepsOrder) {
+    for (size_t blocks : { 1, 2, 3, 64 }) {
+        recording_extractor extractor;
+        shimejifinder::archive_stats stats;
+        shimejifinder::name_pool names;
+        write_pipeline pipeline { &extractor, stats, blocks };
+        auto expected = write_files(pipeline, names, 200);
+        pipeline.finish();
+        EXPECT_EQ(extractor.calls, expected) << blocks << " blocks";
+    }
+}
+
+TEST(WritePipelineTest, RethrowsExtractorErrors) {
+    recording_extractor extractor;
+    extractor.fail_after = 10;
+    shimejifinder::archive_stats stats;
+    shimejifinder::name_pool names;
+    write_pipeline pipeline { &extractor, stats, 4 };
+    EXPECT_THROW({
+        write_files(pipeline, names, 200);
+        pipeline.finish();
+    }, std::runtime_error);
+    // two full files and the third begin_write
+    EXPECT_EQ(extractor.calls.size(), 11U);
+}
+
+TEST(WritePipelineTest, Abort) {
+    recording_extractor extractor;
+    shimejifinder::archive_stats stats;
+    shimejifinder::name_pool names;
+    {
+        write_pipeline pipeline { &extractor, stats, 4 };
+        write_files(pipeline, names, 1);
+        pipeline.abort();
+    }
+    EXPECT_LE(extractor.calls.size(), 5U);
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
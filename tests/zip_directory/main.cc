@@ -0,0 +1,135 @@
+#include <shimejifinder/zip_directory.hpp>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using shimejifinder::zip_directory;
+
+static void put16(std::string &out, uint16_t value) {
+    out += (char)(value & 0xFF);
+    out += (char)(value >> 8);
+}
+
+static void put32(std::string &out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+// builds a zip file of stored entries
+static std::string make_zip(std::vector<std::pair<std::string, std::string>>
+    const& files, std::string const& prefix = "",
+    std::string const& comment = "")
+{
+    std::string out = prefix, directory;
+    for (auto &file : files) {
+        uint32_t offset = (uint32_t)(out.size() - prefix.size());
+        put32(out, 0x04034b50);
+        put16(out, 10); put16(out, 0); put16(out, 0);
+        put16(out, 0); put16(out, 0);
+        put32(out, 0);
+        put32(out, file.second.size()); put32(out, file.second.size());
+        put16(out, file.first.size()); put16(out, 0);
+        out += file.first + file.second;
+
+        put32(directory, 0x02014b50);
+        put16(directory, 0x031E); put16(directory, 10);
+        put16(directory, 0); put16(directory, 0);
+        put16(directory, 0); put16(directory, 0);
+        put32(directory, 0);
+        put32(directory, file.second.size());
+        put32(directory, file.second.size());
+        put16(directory, file.first.size());
+        put16(directory, 0); put16(directory, 0);
+        put16(directory, 0); put16(directory, 0);
+        put32(directory, 0100644 << 16);
+        put32(directory, offset);
+        directory += file.first;
+    }
+    uint32_t directory_offset = (uint32_t)(out.size() - prefix.size());
+    out += directory;
+    put32(out, 0x06054b50);
+    put16(out, 0); put16(out, 0);
+    put16(out, files.size()); put16(out, files.size());
+    put32(out, directory.size());
+    put32(out, directory_offset);
+    put16(out, comment.size());
+    out += comment;
+    return out;
+}
+
+static bool read_directory(std::string const& data, zip_directory &directory) {
+    FILE *file = tmpfile();
+    fwrite(data.data(), 1, data.size(), file);
+    fflush(file);
+    bool ret = directory.read(fileno(file));
+    fclose(file);
+    return ret;
+}
+
+static const std::vector<std::pair<std::string, std::string>> files = {
+    { "pack/img/A/shime1.png", "image" },
+    { "pack/conf/actions.xml", "<Mascot/>" },
+    { "pack/sound/a.wav", "" }
+};
+
+TEST(ZipDirectoryTest, ReadsEntries) {
+    auto data = make_zip(files);
+    zip_directory directory;
+    ASSERT_TRUE(read_directory(data, directory));
+    auto &entries = directory.entries();
+    ASSERT_EQ(entries.size(), files.size());
+    for (size_t i=0; i<files.size(); ++i) {
+        EXPECT_EQ(entries[i].name, files[i].first);
+        EXPECT_EQ(entries[i].size, files[i].second.size());
+        EXPECT_EQ(entries[i].compressed_size, files[i].second.size());
+        EXPECT_EQ(entries[i].method, 0);
+        EXPECT_EQ(data.substr(entries[i].offset + 30, files[i].first.size()),
+            files[i].first);
+    }
+}
+
+TEST(ZipDirectoryTest, Comment) {
+    zip_directory directory;
+    ASSERT_TRUE(read_directory(make_zip(files, "", std::string(1000, 'c')),
+        directory));
+    EXPECT_EQ(directory.entries().size(), files.size());
+}
+
+TEST(ZipDirectoryTest, RejectsDamagedDirectory) {
+    auto data = make_zip(files);
+    zip_directory directory;
+    for (size_t size=0; size<data.size(); ++size) {
+        EXPECT_FALSE(read_directory(data.substr(0, size), directory)) <<
+            "Expected file truncated to " << size << " bytes to be rejected";
+        EXPECT_TRUE(directory.entries().empty());
+    }
+
+    // first central directory header overwritten
+    auto pos = data.find("PK\x01\x02");
+    data[pos + 2] = 'x';
+    EXPECT_FALSE(read_directory(data, directory));
+}
+
+TEST(ZipDirectoryTest, RejectsOtherFiles) {
+    zip_directory directory;
+    EXPECT_FALSE(read_directory("7z\xBC\xAF\x27\x1C", directory));
+    EXPECT_FALSE(read_directory("", directory));
+    EXPECT_FALSE(read_directory(std::string(100, 'x'), directory));
+}
+
+TEST(ZipDirectoryTest, RejectsPrependedData) {
+    zip_directory directory;
+    EXPECT_FALSE(read_directory(make_zip(files, "MZ stub"), directory));
+
+    // starts like a zip file, but every offset is off
+    EXPECT_FALSE(read_directory(make_zip(files, make_zip(files)),
+        directory));
+    EXPECT_TRUE(directory.entries().empty());
+}
+
+int main(int argc, char **argv) {
+    // run tests
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}